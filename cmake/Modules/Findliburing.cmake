@@ -0,0 +1,14 @@
+find_package(PkgConfig)
+pkg_check_modules(LIBURING QUIET liburing)
+
+find_path(LIBURING_INCLUDE_DIR liburing.h
+          HINTS ${PC_LIBURING_INCLUDEDIR} ${PC_LIBURING_INCLUDE_DIRS})
+find_library(LIBURING_LIBRARY NAMES uring
+          HINTS ${PC_LIBURING_LIBDIR} ${PC_LIBURING_LIBRARY_DIRS})
+
+set(LIBURING_LIBRARIES ${LIBURING_LIBRARY})
+set(LIBURING_INCLUDE_DIRS ${LIBURING_INCLUDE_DIR})
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(liburing DEFAULT_MSG LIBURING_LIBRARY LIBURING_INCLUDE_DIR)
+mark_as_advanced(LIBURING_INCLUDE_DIR LIBURING_LIBRARY)
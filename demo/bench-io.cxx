@@ -0,0 +1,81 @@
+#include <asdf/asdf.hxx>
+
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace ASDF;
+
+namespace {
+double elapsed(chrono::steady_clock::time_point start) {
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  cout << "asdf-bench-io: Compare buffered and direct I/O\n";
+  ASDF_CHECK_VERSION();
+
+  // Total size in MiB and number of blocks
+  const int64_t size_mib = argc > 1 ? stoll(argv[1]) : 256;
+  const int64_t nblocks = argc > 2 ? stoll(argv[2]) : 16;
+  assert(size_mib > 0 && nblocks > 0);
+  const int64_t npoints = size_mib * 1024 * 1024 / 8 / nblocks;
+  cout << "  " << nblocks << " blocks of " << npoints * 8 << " bytes\n"
+       << "  direct I/O is "
+       << (have_direct_io() ? "available" : "not available") << "\n";
+
+  auto grp = make_shared<group>();
+  for (int64_t b = 0; b < nblocks; ++b) {
+    vector<float64_t> data(npoints);
+    for (int64_t i = 0; i < npoints; ++i)
+      data[i] = b + i;
+    grp->emplace("array" + to_string(b),
+                 make_shared<ndarray>(std::move(data), block_format_t::block,
+                                      compression_t::none, 0, vector<bool>(),
+                                      vector<int64_t>{npoints}));
+  }
+  const asdf project(map<string, string>(), grp);
+
+  for (const bool direct : {false, true}) {
+    const string filename =
+        direct ? "bench-io-direct.asdf" : "bench-io-buffered.asdf";
+    const string label = direct ? "direct:  " : "buffered:";
+
+    writer_options woptions;
+    woptions.block_alignment = direct_io_alignment();
+    woptions.direct_io.enable = direct;
+    auto start = chrono::steady_clock::now();
+    project.write(filename, woptions);
+    const double write_time = elapsed(start);
+
+    reader_options roptions;
+    roptions.direct_io.enable = direct;
+    start = chrono::steady_clock::now();
+    const asdf project2(filename, {}, roptions);
+    double sum = 0;
+    for (int64_t b = 0; b < nblocks; ++b) {
+      const auto arr = project2.get_group()
+                           ->at("array" + to_string(b))
+                           ->get_maybe_ndarray();
+      const auto data = arr->get_data();
+      const float64_t *ptr = static_cast<const float64_t *>(data->ptr());
+      assert(int64_t(data->nbytes()) == npoints * 8);
+      sum += ptr[0] + ptr[npoints - 1];
+    }
+    const double read_time = elapsed(start);
+    assert(sum == nblocks * (nblocks - 1) + double(nblocks) * (npoints - 1));
+
+    const double mib = size_mib;
+    cout << "  " << label << " write " << mib / write_time << " MiB/s, read "
+         << mib / read_time << " MiB/s\n";
+  }
+
+  cout << "Done.\n";
+  return 0;
+}
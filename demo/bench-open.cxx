@@ -0,0 +1,99 @@
+#include <asdf/asdf.hxx>
+
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace ASDF;
+
+namespace {
+double elapsed(chrono::steady_clock::time_point start) {
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+double read_sum(const asdf &project) {
+  const auto arr = project.get_group()->at("data")->get_maybe_ndarray();
+  const auto data = arr->get_data();
+  const float64_t *ptr = static_cast<const float64_t *>(data->ptr());
+  const int64_t npoints = data->nbytes() / sizeof(float64_t);
+  return ptr[0] + ptr[npoints - 1];
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  cout << "asdf-bench-open: Open many files serially and concurrently\n";
+  ASDF_CHECK_VERSION();
+
+  // Number of files, and number of points per file
+  const int64_t nfiles = argc > 1 ? stoll(argv[1]) : 256;
+  const int64_t npoints = argc > 2 ? stoll(argv[2]) : 65536;
+  assert(nfiles > 0 && npoints > 0);
+  cout << "  " << nfiles << " files of " << npoints * 8 << " bytes\n";
+
+  vector<string> filenames;
+  for (int64_t f = 0; f < nfiles; ++f) {
+    vector<float64_t> data(npoints);
+    for (int64_t i = 0; i < npoints; ++i)
+      data[i] = f + i;
+    auto grp = make_shared<group>();
+    grp->emplace("timestep", make_shared<int_entry>(f));
+    grp->emplace("data",
+                 make_shared<ndarray>(std::move(data), block_format_t::block,
+                                      compression_t::zlib, 1, vector<bool>(),
+                                      vector<int64_t>{npoints}));
+    filenames.push_back("bench-open-" + to_string(f) + ".asdf");
+    asdf(map<string, string>(), grp).write(filenames.back());
+  }
+  const double expected =
+      nfiles * (nfiles - 1) + double(nfiles) * (npoints - 1);
+
+  auto start = chrono::steady_clock::now();
+  double sum = 0;
+  for (const auto &filename : filenames)
+    sum += read_sum(asdf(filename));
+  const double serial_time = elapsed(start);
+  assert(sum == expected);
+
+  open_many_options options;
+  options.prefetch.push_back({"data"});
+  start = chrono::steady_clock::now();
+  const auto projects = asdf::open_many(filenames, options);
+  const double open_time = elapsed(start);
+  sum = 0;
+  for (const auto &project : projects)
+    sum += read_sum(*project);
+  const double parallel_time = elapsed(start);
+  assert(sum == expected);
+
+  // The file cache shares files only while they are unchanged
+  {
+    auto &cache = file_cache::global();
+    const auto rs = cache.open(filenames[0]);
+    assert(cache.open("./" + filenames[0]) == rs);
+    reader_options preload;
+    preload.preload_blocks = true;
+    assert(cache.open(filenames[0], preload) != rs);
+    // Files that are referenced from a file stay open as long as that file
+    if (nfiles > 1) {
+      const weak_ptr<reader_state> ext = rs->get_external_file(filenames[1]);
+      assert(!ext.expired());
+      assert(rs->get_external_file(filenames[1]) == ext.lock());
+    }
+    auto grp = make_shared<group>();
+    grp->emplace("timestep", make_shared<int_entry>(-1));
+    asdf(map<string, string>(), grp).write(filenames[0]);
+    assert(cache.open(filenames[0]) != rs);
+  }
+
+  cout << "  serial:     " << serial_time << " s\n"
+       << "  concurrent: " << parallel_time << " s (" << open_time
+       << " s to open and prefetch)\n";
+
+  cout << "Done.\n";
+  return 0;
+}
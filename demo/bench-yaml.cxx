@@ -0,0 +1,116 @@
+#include <asdf/asdf.hxx>
+
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+using namespace std;
+using namespace ASDF;
+
+namespace {
+double elapsed(chrono::steady_clock::time_point start) {
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int64_t count_nodes(const YAML::Node &node) {
+  int64_t count = 1;
+  if (node.IsMap())
+    for (const auto &kv : node)
+      count += count_nodes(kv.second);
+  else if (node.IsSequence())
+    for (const auto &elt : node)
+      count += count_nodes(elt);
+  return count;
+}
+
+int64_t count_entries(const shared_ptr<entry> &ent) {
+  int64_t count = 1;
+  if (const auto grp = ent->get_maybe_group())
+    for (const auto &kv : *grp)
+      count += count_entries(kv.second);
+  else if (const auto seq = ent->get_maybe_sequence())
+    for (const auto &elt : *seq)
+      count += count_entries(elt);
+  return count;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  cout << "asdf-bench-yaml: Measure emitting and parsing large trees\n";
+  ASDF_CHECK_VERSION();
+
+  // Approximate number of nodes
+  const int64_t nnodes = argc > 1 ? stoll(argv[1]) : 1000000;
+  assert(nnodes > 0);
+  cout << "  YAML parser: " << yaml_parser_name() << "\n";
+
+  // Each item consists of 11 nodes
+  YAML::Node items(YAML::NodeType::Map);
+  const int64_t nitems = (nnodes + 10) / 11;
+  for (int64_t i = 0; i < nitems; ++i) {
+    YAML::Node item(YAML::NodeType::Map);
+    item["name"] = "item " + to_string(i);
+    YAML::Node values(YAML::NodeType::Sequence);
+    for (int j = 0; j < 8; ++j)
+      values.push_back(i + j / 8.0);
+    item["values"] = values;
+    items["item" + to_string(i)] = item;
+  }
+  const int64_t count = count_nodes(items);
+  cout << "  " << count << " nodes\n";
+  const asdf project(map<string, string>(), {{"items", items}});
+
+  auto start = chrono::steady_clock::now();
+  ostringstream os;
+  project.write(os);
+  const double emit_time = elapsed(start);
+  const string file = os.str();
+
+  start = chrono::steady_clock::now();
+  istringstream is(file);
+  const YAML::Node node = asdf::from_yaml(is);
+  const double parse_time = elapsed(start);
+  assert(count_nodes(node["items"]) == count);
+
+  // Convert the tree to entries
+  start = chrono::steady_clock::now();
+  const auto ent = make_entry(nullptr, node["items"]);
+  const int64_t nentries = count_entries(ent);
+  const double load_time = elapsed(start);
+  assert(nentries == count);
+
+  // Convert the entries to a compact tree
+  start = chrono::steady_clock::now();
+  const compact_tree compact(ent);
+  const double compact_time = elapsed(start);
+  assert(int64_t(compact.size()) == count);
+  assert(compact.get_root().at("item0").at("values").size() == 8);
+  assert(count_entries(compact.get_entry()) == count);
+
+  // Build the compact tree directly from YAML
+  start = chrono::steady_clock::now();
+  const compact_tree direct(nullptr, node["items"]);
+  const double direct_time = elapsed(start);
+  assert(int64_t(direct.size()) == count);
+  assert(direct.get_root().at("item0").at("name").get_string() == "item 0");
+  assert(direct.get_root().at("item0").at("values").at(4).get_float() ==
+         compact.get_root().at("item0").at("values").at(4).get_float());
+
+  const double mib = file.size() / (1024.0 * 1024.0);
+  cout << "  emit:  " << emit_time << " s (" << mib / emit_time << " MiB/s)\n"
+       << "  parse: " << parse_time << " s (" << mib / parse_time
+       << " MiB/s)\n"
+       << "  load:  " << load_time << " s (" << count / load_time
+       << " nodes/s)\n"
+       << "  compact: " << compact_time << " s (" << count / compact_time
+       << " nodes/s)\n"
+       << "  compact from YAML: " << direct_time << " s ("
+       << count / direct_time << " nodes/s)\n";
+
+  cout << "Done.\n";
+  return 0;
+}
@@ -0,0 +1,108 @@
+#include <asdf/asdf.hxx>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace ASDF;
+
+namespace {
+// Each process writes the arrays `field<n>` with `n % nprocs == rank`
+shared_ptr<ndarray> make_field(int n, int64_t npoints, bool have_data) {
+  const vector<int64_t> shape{npoints};
+  if (!have_data)
+    // Describe the array without holding its data
+    return make_shared<ndarray>(
+        memoized<block_t>(), std::optional<block_info_t>(),
+        block_format_t::block, compression_t::zlib, 1, vector<bool>(),
+        make_shared<datatype_t>(id_float64), host_byteorder(), shape);
+  vector<float64_t> data(npoints);
+  for (int64_t i = 0; i < npoints; ++i)
+    // Make the arrays compress differently
+    data[i] = n * (i % (n + 1));
+  return make_shared<ndarray>(std::move(data), block_format_t::block,
+                              compression_t::zlib, 1, vector<bool>(), shape);
+}
+
+void write_collectively(const shared_ptr<write_coordinator> &coordinator,
+                        int nfields, int64_t npoints, uint64_t alignment) {
+  const int rank = coordinator->rank();
+  const int nprocs = coordinator->size();
+  auto grp = make_shared<group>();
+  for (int n = 0; n < nfields; ++n)
+    grp->emplace("field" + to_string(n),
+                 make_field(n, npoints, n % nprocs == rank));
+  writer_options options;
+  options.coordinator = coordinator;
+  options.block_alignment = alignment;
+  options.write_statistics = true;
+  asdf(map<string, string>(), grp).write("collective.asdf", options);
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  cout << "asdf-demo-collective: Write a file collectively from several "
+          "processes\n";
+  ASDF_CHECK_VERSION();
+
+  const int nprocs = argc > 1 ? stoi(argv[1]) : 4;
+  const int nfields = argc > 2 ? stoi(argv[2]) : 10;
+  const int64_t npoints = 1000;
+  assert(nprocs >= 1 && nfields >= 0);
+
+  for (const uint64_t alignment : {0, 4096}) {
+    cout << "Writing with " << nprocs << " processes, alignment "
+         << alignment << "...\n";
+    // The second time, exchange the block sizes in several small steps
+    const size_t max_values = alignment == 0 ? 65536 : 3;
+    const auto coordinator =
+        make_shared<shared_memory_coordinator>(nprocs, max_values);
+    vector<pid_t> children;
+    for (int rank = 1; rank < nprocs; ++rank) {
+      const pid_t pid = fork();
+      assert(pid >= 0);
+      if (pid == 0) {
+        coordinator->select_rank(rank);
+        write_collectively(coordinator, nfields, npoints, alignment);
+        _exit(0);
+      }
+      children.push_back(pid);
+    }
+    coordinator->select_rank(0);
+    write_collectively(coordinator, nfields, npoints, alignment);
+    for (const pid_t pid : children) {
+      int status;
+      const pid_t res = waitpid(pid, &status, 0);
+      assert(res == pid);
+      assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    cout << "Reading...\n";
+    const asdf project("collective.asdf");
+    for (int n = 0; n < nfields; ++n) {
+      const auto arr = project.get_group()
+                           ->at("field" + to_string(n))
+                           ->get_maybe_ndarray();
+      const auto data = arr->get_data_vector<float64_t>();
+      assert(int64_t(data.size()) == npoints);
+      for (int64_t i = 0; i < npoints; ++i)
+        assert(data[i] == n * (i % (n + 1)));
+      // Process 0 wrote the statistics of all arrays
+      const auto &stats = arr->get_statistics();
+      assert(stats && stats->count == npoints);
+      assert(stats->min == 0 && stats->max == n * n);
+    }
+  }
+
+  cout << "Done.\n";
+  return 0;
+}
@@ -0,0 +1,179 @@
+#include <asdf/asdf.hxx>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace ASDF;
+
+namespace {
+float64_t position(int64_t i) { return 0.25 * i; }
+int16_t charge(int64_t i) { return int16_t(i % 5 - 2); }
+float32_t momentum(int64_t i, int d) { return float32_t(i + 0.5 * d); }
+
+byteorder_t other_byteorder() {
+  return host_byteorder() == byteorder_t::big ? byteorder_t::little
+                                              : byteorder_t::big;
+}
+
+// An array of records with a vector-valued field, as numpy would write it
+shared_ptr<ndarray> make_particles(int64_t npoints) {
+  const auto datatype = make_shared<datatype_t>(vector<shared_ptr<field_t>>{
+      make_shared<field_t>("position", make_shared<datatype_t>(id_float64),
+                           false, host_byteorder(), vector<int64_t>()),
+      make_shared<field_t>("charge", make_shared<datatype_t>(id_int16), true,
+                           other_byteorder(), vector<int64_t>()),
+      make_shared<field_t>("momentum", make_shared<datatype_t>(id_float32),
+                           false, host_byteorder(), vector<int64_t>{3})});
+  const size_t record_size = datatype->type_size();
+  assert(record_size == 8 + 2 + 3 * 4);
+  vector<unsigned char> records(npoints * record_size);
+  for (int64_t i = 0; i < npoints; ++i) {
+    unsigned char *const rec = &records[i * record_size];
+    const float64_t pos = position(i);
+    memcpy(rec, &pos, 8);
+    const int16_t q = charge(i);
+    memcpy(rec + 8, &q, 2);
+    reverse(rec + 8, rec + 10);
+    for (int d = 0; d < 3; ++d) {
+      const float32_t p = momentum(i, d);
+      memcpy(rec + 10 + 4 * d, &p, 4);
+    }
+  }
+  return make_shared<ndarray>(
+      make_constant_memoized(shared_ptr<block_t>(
+          make_shared<typed_block_t<unsigned char>>(std::move(records)))),
+      std::optional<block_info_t>(), block_format_t::block,
+      compression_t::none, 0, vector<bool>(), datatype, host_byteorder(),
+      vector<int64_t>{npoints});
+}
+
+template <typename T> T load(const unsigned char *ptr, byteorder_t byteorder) {
+  unsigned char bytes[sizeof(T)];
+  memcpy(bytes, ptr, sizeof(T));
+  if (byteorder != host_byteorder())
+    reverse(bytes, bytes + sizeof(T));
+  T val;
+  memcpy(&val, bytes, sizeof(T));
+  return val;
+}
+
+// Check a field, accessing it as strided array
+template <typename T, typename F>
+void check_field(const ndarray &arr, int64_t npoints, const F &expected) {
+  const auto data = arr.get_data();
+  const auto &shape = arr.get_shape();
+  const auto &strides = arr.get_strides();
+  assert(shape.at(0) == npoints);
+  const int64_t ncomps = shape.size() == 1 ? 1 : shape.at(1);
+  const unsigned char *const ptr =
+      static_cast<const unsigned char *>(data->ptr()) + arr.get_offset();
+  for (int64_t i = 0; i < npoints; ++i)
+    for (int64_t d = 0; d < ncomps; ++d) {
+      const int64_t off =
+          i * strides.at(0) + (shape.size() == 1 ? 0 : d * strides.at(1));
+      assert(load<T>(ptr + off, arr.get_byteorder()) == expected(i, d));
+    }
+}
+
+void check_particles(const ndarray &arr, int64_t npoints) {
+  const auto pos = [](int64_t i, int64_t) { return position(i); };
+  const auto q = [](int64_t i, int64_t) { return charge(i); };
+  const auto p = [](int64_t i, int64_t d) { return momentum(i, d); };
+
+  // Strided views
+  check_field<float64_t>(*arr.get_field("position"), npoints, pos);
+  check_field<int16_t>(*arr.get_field("charge"), npoints, q);
+  check_field<float32_t>(*arr.get_field("momentum"), npoints, p);
+
+  // Contiguous copies
+  const auto fields = arr.split_fields();
+  assert(fields.size() == 3);
+  for (const auto &field : fields)
+    assert(field->get_strides().back() ==
+           int64_t(field->get_datatype()->type_size()));
+  check_field<float64_t>(*fields[0], npoints, pos);
+  check_field<int16_t>(*fields[1], npoints, q);
+  check_field<float32_t>(*fields[2], npoints, p);
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  cout << "asdf-demo-compound: Arrays with compound datatypes\n";
+  ASDF_CHECK_VERSION();
+
+  const int64_t npoints = argc > 1 ? stoll(argv[1]) : 1000;
+  assert(npoints >= 0);
+
+  {
+    cout << "Writing...\n";
+    const auto particles = make_particles(npoints);
+    check_particles(*particles, npoints);
+
+    // Assemble records from separate arrays
+    vector<float64_t> xs(npoints), ys(npoints);
+    for (int64_t i = 0; i < npoints; ++i) {
+      xs[i] = i;
+      ys[i] = -i;
+    }
+    const auto points = make_shared<ndarray>(ndarray::join_fields(
+        {"x", "y"},
+        {make_shared<ndarray>(std::move(xs), block_format_t::block,
+                              compression_t::none, 0, vector<bool>(),
+                              vector<int64_t>{npoints}),
+         make_shared<ndarray>(std::move(ys), block_format_t::block,
+                              compression_t::none, 0, vector<bool>(),
+                              vector<int64_t>{npoints})},
+        block_format_t::block, compression_t::zlib, 6));
+
+    auto grp = make_shared<group>();
+    grp->emplace("particles", particles);
+    grp->emplace("points", points);
+    asdf(map<string, string>(), grp).write("compound.asdf");
+  }
+
+  {
+    cout << "Reading...\n";
+    const asdf project("compound.asdf");
+    const auto particles =
+        project.get_group()->at("particles")->get_maybe_ndarray();
+    const auto &datatype = *particles->get_datatype();
+    assert(!datatype.is_scalar);
+    assert(datatype.fields.size() == 3);
+    assert(datatype.fields[1]->have_byteorder);
+    assert(datatype.fields[2]->shape == vector<int64_t>{3});
+    check_particles(*particles, npoints);
+
+    const auto points = project.get_group()->at("points")->get_maybe_ndarray();
+    const auto fields = points->split_fields();
+    const auto xs = fields[0]->get_data_vector<float64_t>();
+    const auto ys = fields[1]->get_data_vector<float64_t>();
+    for (int64_t i = 0; i < npoints; ++i)
+      assert(xs[i] == i && ys[i] == -i);
+  }
+
+  {
+    // String fields, as numpy writes them, are not supported
+    const YAML::Node node =
+        YAML::Load("[{name: x, datatype: float64}, "
+                   "{name: s, datatype: [ascii, 2]}]");
+    bool failed = false;
+    try {
+      datatype_t(nullptr, node);
+    } catch (const invalid_argument &) {
+      failed = true;
+    }
+    assert(failed);
+  }
+
+  cout << "Done.\n";
+  return 0;
+}
@@ -0,0 +1,137 @@
+#include <asdf/asdf.hxx>
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace ASDF;
+
+namespace {
+// The energy increases with the tile number, so that a range query only
+// touches a few tiles
+float64_t energy(int64_t i) { return i % 7 == 3 ? NAN : 0.5 * i; }
+int64_t event_id(int64_t i) { return 1000000 + i; }
+} // namespace
+
+int main(int argc, char **argv) {
+  cout << "asdf-demo-scan: Find matching elements without reading all "
+          "data\n";
+  ASDF_CHECK_VERSION();
+
+  const int ntiles = argc > 1 ? stoi(argv[1]) : 16;
+  const int64_t tile_size = argc > 2 ? stoll(argv[2]) : 10000;
+  assert(ntiles >= 1 && tile_size >= 1);
+  const int64_t npoints = ntiles * tile_size;
+
+  {
+    cout << "Writing " << ntiles << " tiles with " << tile_size
+         << " elements...\n";
+    auto grp = make_shared<group>();
+    vector<float64_t> all_energies(npoints);
+    vector<int64_t> all_ids(npoints);
+    for (int64_t i = 0; i < npoints; ++i) {
+      all_energies[i] = energy(i);
+      all_ids[i] = event_id(i);
+    }
+
+    const auto datatype = make_shared<datatype_t>(id_float64);
+    auto energies = make_shared<tiled_ndarray>(datatype,
+                                               vector<int64_t>{npoints});
+    // Write the tiles in reverse order
+    for (int t = ntiles - 1; t >= 0; --t)
+      energies->add_tile(
+          {t * tile_size},
+          make_shared<ndarray>(
+              vector<float64_t>(all_energies.begin() + t * tile_size,
+                                all_energies.begin() + (t + 1) * tile_size),
+              block_format_t::block, compression_t::zlib, 6, vector<bool>(),
+              vector<int64_t>{tile_size}));
+    grp->emplace("energies", energies);
+
+    vector<shared_ptr<column>> columns{
+        make_shared<column>("energy", all_energies.data(), npoints, "",
+                            compression_t::zlib, 6),
+        make_shared<column>("id", all_ids.data(), npoints, "",
+                            compression_t::zlib, 6)};
+    grp->emplace("events", make_shared<table>(std::move(columns)));
+
+    writer_options options;
+    options.write_statistics = true;
+    asdf(map<string, string>(), grp).write("scan.asdf", options);
+  }
+
+  const asdf project("scan.asdf");
+  const float64_t lo = 0.5 * (npoints / 2), hi = 0.5 * (npoints / 2 + 100);
+  vector<int64_t> expected;
+  for (int64_t i = 0; i < npoints; ++i)
+    if (energy(i) >= lo && energy(i) <= hi)
+      expected.push_back(i);
+
+  {
+    cout << "Scanning tiled array...\n";
+    const auto arr =
+        project.get_group()->at("energies")->get_maybe_tiled_ndarray();
+    assert(arr);
+    const auto rows = scan(*arr, predicate::range(lo, hi));
+    assert(rows == expected);
+    // Only the tiles that can contain matching elements were read
+    int nread = 0;
+    for (const auto &tile : arr->get_tiles())
+      nread += tile.array->get_data().ready();
+    cout << "Read " << nread << " of " << ntiles << " tiles\n";
+    assert(nread <= 2);
+
+    const auto finite_rows = scan(*arr, predicate::finite());
+    int64_t nfinite = 0;
+    for (int64_t i = 0; i < npoints; ++i)
+      nfinite += isfinite(energy(i));
+    assert(int64_t(finite_rows.size()) == nfinite);
+    assert(scan(*arr, predicate::greater(0.5 * npoints)).empty());
+  }
+
+  {
+    cout << "Scanning table...\n";
+    const auto tab = project.get_group()->at("events")->get_maybe_table();
+    assert(tab);
+    // No rows match, so the projected columns are not read
+    const auto empty = scan(*tab, "energy", predicate::less(0), {"id"});
+    assert(empty.rows.empty());
+    assert(!tab->get_column("id")->get_data()->get_data().ready());
+
+    const auto result =
+        scan(*tab, "energy", predicate::range(lo, hi), {"id", "energy"});
+    assert(result.rows == expected);
+    const auto ids =
+        result.values.get_column("id")->get_data()->get_data_vector<int64_t>();
+    assert(ids.size() == expected.size());
+    for (size_t n = 0; n < ids.size(); ++n)
+      assert(ids[n] == event_id(expected[n]));
+  }
+
+  {
+    cout << "Scanning infinities...\n";
+    const float64_t inf = numeric_limits<float64_t>::infinity();
+    const ndarray arr(vector<float64_t>{-inf, 1, inf, NAN},
+                      block_format_t::block, compression_t::none, 0,
+                      vector<bool>(), vector<int64_t>{4});
+    assert(scan(arr, predicate::greater(inf)).empty());
+    assert(scan(arr, predicate::less(-inf)).empty());
+    assert(scan(arr, predicate::greater(-inf)) == (vector<int64_t>{1, 2}));
+    assert(scan(arr, predicate::less(inf)) == (vector<int64_t>{0, 1}));
+    assert(scan(arr, predicate::equal(inf)) == vector<int64_t>{2});
+    assert(scan(arr, predicate::finite()) == vector<int64_t>{1});
+    const statistics_t stats{4, 1, 2, -inf, inf};
+    assert(!predicate::greater(inf).may_match(stats));
+    assert(!predicate::less(-inf).may_match(stats));
+  }
+
+  cout << "Done.\n";
+  return 0;
+}
@@ -0,0 +1,153 @@
+#include <asdf/asdf.hxx>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace ASDF;
+
+namespace {
+byteorder_t other_byteorder() {
+  return host_byteorder() == byteorder_t::big ? byteorder_t::little
+                                              : byteorder_t::big;
+}
+
+// An array of the given values, stored in the given byte order
+template <typename T>
+shared_ptr<ndarray> make_array(const vector<T> &values, byteorder_t byteorder,
+                               const vector<int64_t> &shape,
+                               int64_t offset = 0,
+                               vector<int64_t> strides = {}) {
+  vector<unsigned char> bytes(values.size() * sizeof(T));
+  for (size_t i = 0; i < values.size(); ++i) {
+    unsigned char *const ptr = &bytes[i * sizeof(T)];
+    memcpy(ptr, &values[i], sizeof(T));
+    if (byteorder != host_byteorder())
+      reverse(ptr, ptr + sizeof(T));
+  }
+  return make_shared<ndarray>(
+      make_constant_memoized(shared_ptr<block_t>(
+          make_shared<typed_block_t<unsigned char>>(std::move(bytes)))),
+      std::optional<block_info_t>(), block_format_t::block,
+      compression_t::none, 0, vector<bool>(),
+      make_shared<datatype_t>(get_scalar_type_id<T>::value), byteorder, shape,
+      offset, std::move(strides));
+}
+
+void check(const ndarray &arr, int64_t count, int64_t nan_count,
+           int64_t inf_count, std::optional<float64_t> min,
+           std::optional<float64_t> max) {
+  const auto stats = arr.calculate_statistics();
+  assert(stats);
+  assert(stats->count == count);
+  assert(stats->nan_count == nan_count);
+  assert(stats->inf_count == inf_count);
+  assert(stats->min == min);
+  assert(stats->max == max);
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  cout << "asdf-demo-statistics: Calculate, write, and read array "
+          "statistics\n";
+  ASDF_CHECK_VERSION();
+
+  const float64_t inf = numeric_limits<float64_t>::infinity();
+  const float64_t nan = numeric_limits<float64_t>::quiet_NaN();
+
+  cout << "Calculating...\n";
+
+  // NaNs are counted, but do not contribute to the range; infinities do
+  const auto floats =
+      make_array<float64_t>({1.5, nan, -inf, inf, -2.5}, host_byteorder(), {5});
+  check(*floats, 5, 1, 2, -inf, inf);
+  const auto nans =
+      make_array<float32_t>({NAN, NAN, NAN}, other_byteorder(), {3});
+  check(*nans, 3, 3, 0, {}, {});
+  const auto finite =
+      make_array<float32_t>({0.25f, -1.0f, 8.0f}, other_byteorder(), {3});
+  check(*finite, 3, 0, 0, -1.0, 8.0);
+
+  // Integers that are not exactly representable are rounded outwards
+  const auto int64s = make_array<int64_t>(
+      {numeric_limits<int64_t>::min(), 0, numeric_limits<int64_t>::max()},
+      other_byteorder(), {3});
+  check(*int64s, 3, 0, 0, -ldexp(1.0, 63), ldexp(1.0, 63));
+  const auto uint64s = make_array<uint64_t>(
+      {numeric_limits<uint64_t>::max(), 1}, host_byteorder(), {2});
+  check(*uint64s, 2, 0, 0, 1.0, ldexp(1.0, 64));
+  const int64_t odd = (int64_t(1) << 53) + 1;
+  const auto inexact = make_array<int64_t>({odd}, host_byteorder(), {});
+  check(*inexact, 1, 0, 0, ldexp(1.0, 53), ldexp(1.0, 53) + 2);
+  const auto int32s =
+      make_array<int32_t>({-7, 100, 3}, other_byteorder(), {3});
+  check(*int32s, 3, 0, 0, -7.0, 100.0);
+
+  // Only the elements of a strided view are considered: rows 1 and 3 of a
+  // 4x3 array
+  vector<int16_t> grid(12);
+  for (int i = 0; i < 12; ++i)
+    grid[i] = i;
+  const auto rows =
+      make_array<int16_t>(grid, other_byteorder(), {2, 3}, 3 * 2, {12, 2});
+  check(*rows, 6, 0, 0, 3.0, 11.0);
+  // Every other column, in reverse order
+  const auto columns = make_array<int16_t>(grid, host_byteorder(), {4, 2},
+                                           2 * 2, {6, -4});
+  check(*columns, 8, 0, 0, 0.0, 11.0);
+
+  const auto empty = make_array<float64_t>({}, host_byteorder(), {0});
+  check(*empty, 0, 0, 0, {}, {});
+
+  cout << "Writing...\n";
+  {
+    auto grp = make_shared<group>();
+    grp->emplace("floats", floats);
+    grp->emplace("int64s", int64s);
+    grp->emplace("rows", rows);
+    asdf(map<string, string>(), grp).write("statistics.asdf");
+  }
+
+  cout << "Reading...\n";
+  {
+    const asdf project("statistics.asdf");
+    const auto arr = project.get_group()->at("int64s")->get_maybe_ndarray();
+    assert(!arr->get_statistics());
+
+    // The data that are read only for calculating the statistics are not
+    // kept in memory
+    writer_options options;
+    options.write_statistics = true;
+    asdf(map<string, string>(), project.get_group())
+        .write("statistics2.asdf", options);
+    assert(!arr->get_data().ready());
+  }
+  {
+    const asdf project("statistics2.asdf");
+    const auto grp = project.get_group();
+    const auto &stats =
+        grp->at("floats")->get_maybe_ndarray()->get_statistics();
+    assert(stats && stats->count == 5 && stats->nan_count == 1 &&
+           stats->inf_count == 2 && stats->min == -inf && stats->max == inf);
+    const auto &int64_stats =
+        grp->at("int64s")->get_maybe_ndarray()->get_statistics();
+    assert(int64_stats && int64_stats->min == -ldexp(1.0, 63) &&
+           int64_stats->max == ldexp(1.0, 63));
+    const auto &rows_stats =
+        grp->at("rows")->get_maybe_ndarray()->get_statistics();
+    assert(rows_stats && rows_stats->count == 6 && rows_stats->min == 3.0 &&
+           rows_stats->max == 11.0);
+  }
+
+  cout << "Done.\n";
+  return 0;
+}
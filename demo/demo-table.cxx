@@ -0,0 +1,76 @@
+#include <asdf/asdf.hxx>
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace ASDF;
+
+namespace {
+float64_t value(int c, int64_t i) { return c + 0.001 * (i % 1000); }
+} // namespace
+
+int main(int argc, char **argv) {
+  cout << "asdf-demo-table: Write a table, and read only some of its "
+          "columns\n";
+  ASDF_CHECK_VERSION();
+
+  const int ncolumns = argc > 1 ? stoi(argv[1]) : 200;
+  const int64_t nrows = argc > 2 ? stoll(argv[2]) : 10000;
+  assert(ncolumns >= 3 && nrows >= 0);
+
+  {
+    cout << "Writing " << ncolumns << " columns with " << nrows
+         << " rows...\n";
+    // The columns refer to these data, which are not copied
+    vector<vector<float64_t>> data(ncolumns);
+    vector<shared_ptr<column>> columns;
+    for (int c = 0; c < ncolumns; ++c) {
+      data[c].resize(nrows);
+      for (int64_t i = 0; i < nrows; ++i)
+        data[c][i] = value(c, i);
+      columns.push_back(make_shared<column>("column" + to_string(c),
+                                            data[c].data(), nrows,
+                                            "column " + to_string(c),
+                                            compression_t::zlib, 6));
+    }
+    auto grp = make_shared<group>();
+    grp->emplace("catalog", make_shared<table>(std::move(columns)));
+    writer_options options;
+    options.nthreads = 0;
+    asdf(map<string, string>(), grp).write("table.asdf", options);
+  }
+
+  {
+    cout << "Reading 3 columns...\n";
+    const asdf project("table.asdf");
+    const auto tab = project.get_group()->at("catalog")->get_maybe_table();
+    assert(tab);
+    assert(int(tab->get_columns().size()) == ncolumns);
+    const vector<int> selected{1, ncolumns / 2, ncolumns - 1};
+    vector<string> names;
+    for (const int c : selected)
+      names.push_back("column" + to_string(c));
+    const table subset = tab->select(names);
+    subset.read();
+    for (size_t n = 0; n < selected.size(); ++n) {
+      const auto &col = subset.get_columns().at(n);
+      assert(col->get_name() == names.at(n));
+      assert(col->get_data()->get_data().ready());
+      const auto data = col->get_data()->get_data_vector<float64_t>();
+      assert(int64_t(data.size()) == nrows);
+      for (int64_t i = 0; i < nrows; ++i)
+        assert(data[i] == value(selected[n], i));
+    }
+    // The other columns have not been read
+    assert(!tab->get_column("column0")->get_data()->get_data().ready());
+  }
+
+  cout << "Done.\n";
+  return 0;
+}
@@ -0,0 +1,207 @@
+#include <asdf/asdf.hxx>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace ASDF;
+
+namespace {
+const vector<int64_t> global_shape{10, 12};
+
+int64_t value(int64_t i, int64_t j) { return 1000 * i + j; }
+
+// Each process owns a range of rows, which it splits into two tiles along
+// the columns
+void get_tiles(int rank, int nprocs, vector<vector<int64_t>> &offsets,
+               vector<vector<int64_t>> &shapes) {
+  const int64_t ni = global_shape[0], nj = global_shape[1];
+  const int64_t i0 = rank * ni / nprocs, i1 = (rank + 1) * ni / nprocs;
+  const int64_t j0 = 0, j1 = nj / 3, j2 = nj;
+  offsets = {{i0, j0}, {i0, j1}};
+  shapes = {{i1 - i0, j1 - j0}, {i1 - i0, j2 - j1}};
+}
+
+shared_ptr<tiled_ndarray> make_array(int rank, int nprocs) {
+  const auto datatype = make_shared<datatype_t>(id_int64);
+  auto arr = make_shared<tiled_ndarray>(datatype, global_shape);
+  for (int p = 0; p < nprocs; ++p) {
+    vector<vector<int64_t>> offsets, shapes;
+    get_tiles(p, nprocs, offsets, shapes);
+    for (size_t t = 0; t < offsets.size(); ++t) {
+      const auto &offset = offsets[t];
+      const auto &shape = shapes[t];
+      shared_ptr<ndarray> tile;
+      if (p != rank) {
+        // Describe the tile without holding its data
+        tile = make_shared<ndarray>(
+            memoized<block_t>(), std::optional<block_info_t>(),
+            block_format_t::block, compression_t::none, 0, vector<bool>(),
+            datatype, host_byteorder(), shape);
+      } else {
+        vector<int64_t> data;
+        for (int64_t i = 0; i < shape[0]; ++i)
+          for (int64_t j = 0; j < shape[1]; ++j)
+            data.push_back(value(offset[0] + i, offset[1] + j));
+        tile = make_shared<ndarray>(std::move(data), block_format_t::block,
+                                    compression_t::none, 0, vector<bool>(),
+                                    shape);
+      }
+      arr->add_tile(offset, tile);
+    }
+  }
+  return arr;
+}
+
+void write_collectively(const shared_ptr<write_coordinator> &coordinator) {
+  auto grp = make_shared<group>();
+  grp->emplace("field", make_array(coordinator->rank(), coordinator->size()));
+  writer_options options;
+  options.coordinator = coordinator;
+  asdf(map<string, string>(), grp).write("tiled.asdf", options);
+}
+
+// A one-dimensional array of records, whose tiles are stored in different
+// byte orders. The field `b` is always stored as big endian.
+shared_ptr<datatype_t> record_datatype() {
+  return make_shared<datatype_t>(vector<shared_ptr<field_t>>{
+      make_shared<field_t>("a", make_shared<datatype_t>(id_int32), false,
+                           byteorder_t::undefined, vector<int64_t>()),
+      make_shared<field_t>("b", make_shared<datatype_t>(id_float64), true,
+                           byteorder_t::big, vector<int64_t>{2})});
+}
+
+template <typename T>
+void store(unsigned char *ptr, T value, byteorder_t byteorder) {
+  memcpy(ptr, &value, sizeof value);
+  if (byteorder != host_byteorder())
+    reverse(ptr, ptr + sizeof value);
+}
+
+shared_ptr<ndarray> make_record_tile(const shared_ptr<datatype_t> &datatype,
+                                     int64_t offset, int64_t size,
+                                     byteorder_t byteorder) {
+  const size_t record_size = datatype->type_size();
+  vector<unsigned char> records(size * record_size);
+  for (int64_t i = 0; i < size; ++i) {
+    unsigned char *const rec = &records[i * record_size];
+    store(rec, int32_t(offset + i), byteorder);
+    for (int c = 0; c < 2; ++c)
+      store(rec + 4 + 8 * c, float64_t(offset + i + 0.5 * c), byteorder_t::big);
+  }
+  return make_shared<ndarray>(
+      make_constant_memoized(shared_ptr<block_t>(
+          make_shared<typed_block_t<unsigned char>>(std::move(records)))),
+      std::optional<block_info_t>(), block_format_t::block,
+      compression_t::none, 0, vector<bool>(), datatype, byteorder,
+      vector<int64_t>{size});
+}
+
+void check_records(const tiled_ndarray &arr, int64_t npoints) {
+  const auto block = arr.read();
+  const size_t record_size = arr.get_datatype()->type_size();
+  assert(block->nbytes() == npoints * record_size);
+  const unsigned char *const ptr =
+      static_cast<const unsigned char *>(block->ptr());
+  for (int64_t i = 0; i < npoints; ++i) {
+    int32_t a;
+    memcpy(&a, ptr + i * record_size, sizeof a);
+    assert(a == i);
+    for (int c = 0; c < 2; ++c) {
+      float64_t b;
+      memcpy(&b, ptr + i * record_size + 4 + 8 * c, sizeof b);
+      assert(b == i + 0.5 * c);
+    }
+  }
+}
+
+void check_region(const tiled_ndarray &arr, const vector<int64_t> &begin,
+                  const vector<int64_t> &end) {
+  const auto block = arr.read_region(begin, end);
+  const int64_t ni = end[0] - begin[0], nj = end[1] - begin[1];
+  assert(int64_t(block->nbytes()) == ni * nj * int64_t(sizeof(int64_t)));
+  const int64_t *const data = static_cast<const int64_t *>(block->ptr());
+  for (int64_t i = 0; i < ni; ++i)
+    for (int64_t j = 0; j < nj; ++j)
+      assert(data[i * nj + j] == value(begin[0] + i, begin[1] + j));
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  cout << "asdf-demo-tiled: Assemble an array from tiles written by several "
+          "processes\n";
+  ASDF_CHECK_VERSION();
+
+  const int nprocs = argc > 1 ? stoi(argv[1]) : 4;
+  assert(nprocs >= 1 && nprocs <= global_shape[0]);
+
+  cout << "Writing with " << nprocs << " processes...\n";
+  const auto coordinator = make_shared<shared_memory_coordinator>(nprocs);
+  vector<pid_t> children;
+  for (int rank = 1; rank < nprocs; ++rank) {
+    const pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+      coordinator->select_rank(rank);
+      write_collectively(coordinator);
+      _exit(0);
+    }
+    children.push_back(pid);
+  }
+  coordinator->select_rank(0);
+  write_collectively(coordinator);
+  for (const pid_t pid : children) {
+    int status;
+    const pid_t res = waitpid(pid, &status, 0);
+    assert(res == pid);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+
+  cout << "Reading...\n";
+  const asdf project("tiled.asdf");
+  const auto arr = project.get_group()->at("field")->get_maybe_tiled_ndarray();
+  assert(arr);
+  assert(arr->get_shape() == global_shape);
+  assert(int(arr->get_tiles().size()) == 2 * nprocs);
+  check_region(*arr, {0, 0}, global_shape);
+  // A region within a single tile
+  check_region(*arr, {0, 0}, {1, 2});
+  // A region that crosses tile boundaries
+  check_region(*arr, {1, 3}, {global_shape[0] - 1, global_shape[1] - 1});
+  // An empty region
+  check_region(*arr, {2, 2}, {2, 5});
+
+  cout << "Writing records in different byte orders...\n";
+  {
+    const int64_t npoints = 10;
+    const auto datatype = record_datatype();
+    auto records =
+        make_shared<tiled_ndarray>(datatype, vector<int64_t>{npoints});
+    records->add_tile({0}, make_record_tile(datatype, 0, 4, byteorder_t::big));
+    records->add_tile({4},
+                      make_record_tile(datatype, 4, 6, byteorder_t::little));
+    check_records(*records, npoints);
+    auto grp = make_shared<group>();
+    grp->emplace("records", records);
+    asdf(map<string, string>(), grp).write("tiled-records.asdf");
+
+    const asdf project("tiled-records.asdf");
+    check_records(
+        *project.get_group()->at("records")->get_maybe_tiled_ndarray(),
+        npoints);
+  }
+
+  cout << "Done.\n";
+  return 0;
+}
@@ -0,0 +1,101 @@
+#include <asdf/asdf.hxx>
+
+#include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace ASDF;
+
+namespace {
+// Documents that exercise the differences between YAML parsers
+const vector<string> documents{
+    "a: 1\nb: [2, 3.5, ~, null, '', \"x\"]\nc: {d: true, e: !!str 4}\n",
+    "base: &base {x: 1, y: [1, 2]}\ncopy: *base\nlist: [&v 7, *v]\n",
+    "%TAG !asdf! tag:stsci.edu:asdf/\n--- !asdf!core/asdf-1.1.0\n"
+    "array: !asdf!core/ndarray-1.0.0\n  data: [1, 2]\n  datatype: int64\n"
+    "local: !local {}\n...\n",
+    "empty:\nquoted: 'null'\nplain: null\nmultiline: |\n  line 1\n  line 2\n",
+};
+
+bool same_node(const YAML::Node &x, const YAML::Node &y, const string &path) {
+  const auto fail = [&](const string &what) {
+    cerr << "Mismatch at " << path << ": " << what << "\n";
+    return false;
+  };
+  if (x.Type() != y.Type())
+    return fail("type");
+  if (x.Tag() != y.Tag())
+    return fail("tag \"" + x.Tag() + "\" vs. \"" + y.Tag() + "\"");
+  switch (x.Type()) {
+  case YAML::NodeType::Scalar:
+    if (x.Scalar() != y.Scalar())
+      return fail("value \"" + x.Scalar() + "\" vs. \"" + y.Scalar() + "\"");
+    return true;
+  case YAML::NodeType::Sequence:
+    if (x.size() != y.size())
+      return fail("size");
+    for (size_t i = 0; i < x.size(); ++i)
+      if (!same_node(x[i], y[i], path + "/" + to_string(i)))
+        return false;
+    return true;
+  case YAML::NodeType::Map: {
+    if (x.size() != y.size())
+      return fail("size");
+    // Compare in order; the order of keys matters for round trips
+    auto xi = x.begin(), yi = y.begin();
+    for (; xi != x.end(); ++xi, ++yi) {
+      const string key = xi->first.Scalar();
+      if (key != yi->first.Scalar())
+        return fail("key \"" + key + "\" vs. \"" + yi->first.Scalar() + "\"");
+      if (!same_node(xi->second, yi->second, path + "/" + key))
+        return false;
+    }
+    return true;
+  }
+  default:
+    return true;
+  }
+}
+
+// Parse a document with the selected parser and with yaml-cpp
+bool check(const string &name, string text) {
+  const YAML::Node expected = YAML::Load(text);
+  const YAML::Node node = yaml_parse(&text[0], &text[0] + text.size());
+  return same_node(node, expected, name);
+}
+
+// The YAML tree at the beginning of an ASDF file
+string read_tree(const string &filename) {
+  ifstream is(filename, ios::binary);
+  assert(is.good());
+  string file((istreambuf_iterator<char>(is)), istreambuf_iterator<char>());
+  const string marker = "\n...\n";
+  const size_t pos = file.find(marker);
+  assert(pos != string::npos);
+  return file.substr(0, pos + marker.size());
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  cout << "asdf-demo-yaml-parser: Compare the YAML parser with yaml-cpp\n";
+  ASDF_CHECK_VERSION();
+  cout << "  YAML parser: " << yaml_parser_name() << "\n";
+
+  bool success = true;
+  for (size_t n = 0; n < documents.size(); ++n)
+    success &= check("document" + to_string(n), documents[n]);
+  for (int i = 1; i < argc; ++i)
+    success &= check(argv[i], read_tree(argv[i]));
+  if (!success) {
+    cerr << "The YAML parsers disagree\n";
+    return 1;
+  }
+
+  cout << "Done.\n";
+  return 0;
+}
@@ -1,26 +1,50 @@
 #ifndef ASDF_ASDF_HXX
 #define ASDF_ASDF_HXX
 
+#include <asdf/batch_io.hxx>
 #include <asdf/byteorder.hxx>
+#include <asdf/collective.hxx>
+#include <asdf/compact.hxx>
 #include <asdf/config.hxx>
 #include <asdf/datatype.hxx>
+#include <asdf/direct_io.hxx>
 #include <asdf/entry.hxx>
+#include <asdf/file_cache.hxx>
 #include <asdf/io.hxx>
 #include <asdf/ndarray.hxx>
+#include <asdf/parallel.hxx>
 #include <asdf/reference.hxx>
+#include <asdf/scan.hxx>
 #include <asdf/stl.hxx>
 #include <asdf/table.hxx>
+#include <asdf/tiled_ndarray.hxx>
+#include <asdf/yaml_parser.hxx>
 
 #include <yaml-cpp/yaml.h>
 
+#include <functional>
 #include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace ASDF {
 using namespace std;
 
 // ASDF
 
+struct open_many_options {
+  // Number of files that are opened concurrently. If this is 0 or less,
+  // use all hardware threads.
+  int nthreads = 0;
+  reader_options reader;
+  // Paths (group keys or sequence indices) of arrays whose data are read
+  // as soon as a file has been opened. If a path names a group or
+  // sequence, all arrays in it are read. Paths that do not exist in a file
+  // are ignored.
+  vector<vector<string>> prefetch;
+};
+
 class asdf {
   // For writing
   map<string, string> tags; // tag directives
@@ -71,11 +95,25 @@ public:
 
   static YAML::Node from_yaml(istream &is);
   asdf(const shared_ptr<istream> &pis, const string &filename = {},
-       const map<string, reader_t> &readers = {});
-  asdf(const string &filename, const map<string, reader_t> &readers = {});
+       const map<string, reader_t> &readers = {},
+       const reader_options &options = {});
+  asdf(const string &filename, const map<string, reader_t> &readers = {},
+       const reader_options &options = {});
+  // Open several files concurrently. `ready(n, project)` is called as soon
+  // as file `n` has been opened and its prefetched arrays have been read.
+  // The calls are serialized, but happen in no particular order.
+  static void
+  open_many(const vector<string> &filenames,
+            const function<void(size_t n, const shared_ptr<asdf> &project)>
+                &ready,
+            const open_many_options &options = {});
+  static vector<shared_ptr<asdf>>
+  open_many(const vector<string> &filenames,
+            const open_many_options &options = {});
+
   asdf copy(const copy_state &cs) const;
-  void write(ostream &os) const;
-  void write(const string &filename) const;
+  void write(ostream &os, const writer_options &options = {}) const;
+  void write(const string &filename, const writer_options &options = {}) const;
 
   shared_ptr<group> get_group() const { return grp; }
 };
@@ -0,0 +1,37 @@
+#ifndef ASDF_BATCH_IO_HXX
+#define ASDF_BATCH_IO_HXX
+
+#include <asdf/io.hxx>
+#include <asdf/ndarray.hxx>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace ASDF {
+using namespace std;
+
+// Batched reads
+
+struct read_request_t {
+  streamoff pos;
+  size_t count;
+};
+
+typedef function<void(size_t n, const shared_ptr<block_t> &data)> read_done_t;
+
+// Read all requests from the file `fd`. `done(n, data)` is called for
+// request `n` as soon as its data have been read, on one of
+// `options.nthreads` threads. This uses io_uring if available, and a
+// thread pool calling `pread` otherwise.
+void batch_read(int fd, const vector<read_request_t> &requests,
+                const batch_read_options &options, const read_done_t &done);
+
+} // namespace ASDF
+
+#define ASDF_BATCH_IO_HXX_DONE
+#endif // #ifndef ASDF_BATCH_IO_HXX
+#ifndef ASDF_BATCH_IO_HXX_DONE
+#error "Cyclic include depencency"
+#endif
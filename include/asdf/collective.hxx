@@ -0,0 +1,80 @@
+#ifndef ASDF_COLLECTIVE_HXX
+#define ASDF_COLLECTIVE_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ASDF {
+using namespace std;
+
+// Collective writing
+
+// A coordinator connects several processes (e.g. MPI ranks) that write a
+// single file together (see writer_options::coordinator). All processes
+// describe the same tree, and each block is written by the process that
+// holds its data. The coordinator exchanges the block sizes so that every
+// process can determine the offsets of its blocks; process 0 writes the
+// tree and the block index.
+//
+// An MPI-based coordinator would implement `allreduce_sum` via
+// `MPI_Allreduce` with `MPI_SUM`.
+//
+// The processes synchronize several times while writing. If one process
+// throws an exception (e.g. because a block cannot be written), the other
+// processes wait for it forever. Applications need to abort all processes
+// in this case, e.g. via `MPI_Abort`.
+class write_coordinator {
+public:
+  virtual ~write_coordinator() {}
+
+  virtual int rank() const = 0;
+  virtual int size() const = 0;
+
+  // Sum `values` element-wise over all processes. All processes must call
+  // this with the same number of values.
+  virtual void allreduce_sum(vector<uint64_t> &values) = 0;
+
+  void barrier() {
+    vector<uint64_t> dummy(1);
+    allreduce_sum(dummy);
+  }
+};
+
+// A coordinator for processes on the same node that are created via
+// `fork`. The coordinator must be created before forking, and every process
+// must then select its rank.
+class shared_memory_coordinator : public write_coordinator {
+  struct shared_state_t;
+  shared_state_t *state;
+  size_t state_size;
+  int nprocs;
+  int my_rank;
+
+public:
+  shared_memory_coordinator() = delete;
+  shared_memory_coordinator(const shared_memory_coordinator &) = delete;
+  shared_memory_coordinator(shared_memory_coordinator &&) = delete;
+  shared_memory_coordinator &
+  operator=(const shared_memory_coordinator &) = delete;
+  shared_memory_coordinator &operator=(shared_memory_coordinator &&) = delete;
+
+  // `max_values` is the number of values that are reduced at once; more
+  // values are reduced in several steps
+  shared_memory_coordinator(int nprocs, size_t max_values = 65536);
+  ~shared_memory_coordinator();
+
+  void select_rank(int rank);
+
+  int rank() const override { return my_rank; }
+  int size() const override { return nprocs; }
+  void allreduce_sum(vector<uint64_t> &values) override;
+};
+
+} // namespace ASDF
+
+#define ASDF_COLLECTIVE_HXX_DONE
+#endif // #ifndef ASDF_COLLECTIVE_HXX
+#ifndef ASDF_COLLECTIVE_HXX_DONE
+#error "Cyclic include depencency"
+#endif
@@ -0,0 +1,119 @@
+#ifndef ASDF_COMPACT_HXX
+#define ASDF_COMPACT_HXX
+
+#include <asdf/entry.hxx>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ASDF {
+using namespace std;
+
+// Compact entry trees
+
+// A compact_tree holds a tree of entries in a few contiguous arrays
+// instead of one heap object per entry. Group keys are interned, and the
+// entries of a group are sorted by key. Nodes are accessed via
+// compact_entry handles, which are cheap to copy and remain valid as long
+// as the tree is alive. (Trees cannot be moved.)
+
+class compact_tree;
+
+class compact_entry {
+  const compact_tree *tree;
+  uint32_t index;
+
+  friend class compact_tree;
+  compact_entry(const compact_tree *tree, uint32_t index)
+      : tree(tree), index(index) {}
+
+public:
+  compact_entry() = delete;
+
+  entry_type_t get_entry_type() const;
+
+  bool get_bool() const;
+  int64_t get_int() const;
+  float64_t get_float() const;
+  string_view get_string() const;
+
+  // Sequences and groups
+  size_t size() const;
+  compact_entry at(size_t n) const;
+  // Groups
+  string_view key(size_t n) const;
+  optional<compact_entry> find(string_view key) const;
+  compact_entry at(string_view key) const;
+
+  // Convert to an entry. Entries of other types (e.g. arrays or
+  // references) are shared with the entry tree the compact tree was built
+  // from.
+  shared_ptr<entry> get_entry() const;
+};
+
+class compact_tree {
+  friend class compact_entry;
+
+  struct node_t {
+    entry_type_t type;
+    // Number of children for sequences and groups, length for strings
+    uint32_t size;
+    union {
+      bool bool_value;
+      int64_t int_value;
+      float64_t float_value;
+      // Position of the first child in `children` and `keys` for sequences
+      // and groups, of the first character in `text` for strings, and of
+      // the object in `objects` for all other types
+      uint64_t pos;
+    };
+  };
+
+  vector<node_t> nodes;
+  vector<uint32_t> children;
+  vector<uint32_t> keys;     // key ids, only meaningful for groups
+  // Indexed by key id. A deque does not move its elements when it grows,
+  // so that `key_ids` can refer to them.
+  deque<string> key_names;
+  unordered_map<string_view, uint32_t> key_ids;
+  string text;
+  vector<shared_ptr<entry>> objects;
+
+  uint32_t intern(string_view key);
+  uint32_t add(const shared_ptr<entry> &ent);
+  uint32_t add(const shared_ptr<reader_state> &rs, const YAML::Node &node);
+  shared_ptr<entry> make_entry(uint32_t index) const;
+
+public:
+  compact_tree() = delete;
+  // Handles refer to the tree, so it cannot be copied or moved
+  compact_tree(const compact_tree &) = delete;
+  compact_tree(compact_tree &&) = delete;
+  compact_tree &operator=(const compact_tree &) = delete;
+  compact_tree &operator=(compact_tree &&) = delete;
+
+  explicit compact_tree(const shared_ptr<entry> &root);
+  // Build the tree directly from YAML, without creating an entry for each
+  // node. Only nodes with a tag (e.g. arrays) and references become
+  // entries.
+  compact_tree(const shared_ptr<reader_state> &rs, const YAML::Node &root);
+
+  size_t size() const { return nodes.size(); }
+  compact_entry get_root() const { return compact_entry(this, 0); }
+  shared_ptr<entry> get_entry() const { return get_root().get_entry(); }
+};
+
+} // namespace ASDF
+
+#define ASDF_COMPACT_HXX_DONE
+#endif // #ifndef ASDF_COMPACT_HXX
+#ifndef ASDF_COMPACT_HXX_DONE
+#error "Cyclic include depencency"
+#endif
@@ -2,11 +2,14 @@
 #define ASDF_DATATYPE_HXX
 
 #include <asdf/byteorder.hxx>
+#include <asdf/config.hxx>
 #include <asdf/io.hxx>
 
 #include <yaml-cpp/yaml.h>
 
 #include <complex>
+#include <optional>
+#include <string_view>
 #include <type_traits>
 #include <vector>
 
@@ -226,6 +229,13 @@ void yaml_decode(const YAML::Node &node, complex32_t &val);
 void yaml_decode(const YAML::Node &node, complex64_t &val);
 void yaml_decode(const YAML::Node &node, complex128_t &val);
 
+// Parse plain scalars following the YAML 1.1 rules for booleans, integers,
+// and floating-point numbers. These do not throw, so that scalars of a
+// different type are cheap to detect.
+optional<bool8_t> parse_yaml_bool(string_view str);
+optional<int64_t> parse_yaml_int(string_view str);
+optional<float64_t> parse_yaml_float(string_view str);
+
 YAML::Node yaml_encode(bool8_t val);
 YAML::Node yaml_encode(int8_t val);
 YAML::Node yaml_encode(int16_t val);
@@ -258,6 +268,12 @@ void parse_scalar(const YAML::Node &node, unsigned char *data,
 YAML::Node emit_scalar(const unsigned char *data,
                        scalar_type_id_t scalar_type_id,
                        byteorder_t byteorder = host_byteorder());
+// Format a boolean, integer, or floating-point scalar as a plain YAML
+// scalar. Floating-point numbers use the shortest representation that
+// round-trips. Returns an empty string for other types.
+string format_scalar(const unsigned char *data,
+                     scalar_type_id_t scalar_type_id,
+                     byteorder_t byteorder = host_byteorder());
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -287,6 +303,9 @@ public:
   field_t(const copy_state &cs, const field_t &field);
   YAML::Node to_yaml() const;
   YAML::Node to_yaml(writer &w) const { return to_yaml(); }
+
+  // Size of the field in a record, including its shape
+  size_t type_size() const;
 };
 
 inline YAML::Node yaml_encode(const field_t &field) { return field.to_yaml(); }
@@ -313,6 +332,12 @@ public:
   YAML::Node to_yaml(writer &w) const { return to_yaml(); }
 
   size_t type_size() const;
+
+  // Index of the field with the given name; throws `out_of_range` if there
+  // is no such field
+  size_t get_field_index(const string &name) const;
+  // Offset (in bytes) of a field in a record
+  size_t get_field_offset(size_t index) const;
 };
 
 inline YAML::Node yaml_encode(const datatype_t &datatype) {
@@ -0,0 +1,114 @@
+#ifndef ASDF_DIRECT_IO_HXX
+#define ASDF_DIRECT_IO_HXX
+
+#include <asdf/io.hxx>
+#include <asdf/ndarray.hxx>
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ASDF {
+using namespace std;
+
+// Direct I/O
+
+// Alignment of buffers, file offsets, and sizes for direct I/O
+size_t direct_io_alignment();
+
+// Write all `count` bytes at file position `offset`
+void pwrite_all(int fd, const void *buf, size_t count, off_t offset);
+
+// Read blocks from a file with direct I/O
+class direct_reader {
+  int fd;
+  direct_io_options options;
+
+  mutex mtx;
+  // Positions and sizes of all blocks, sorted by position
+  vector<pair<streamoff, size_t>> ranges;
+  // The block that is currently read ahead
+  pair<streamoff, size_t> prefetch_range;
+  future<shared_ptr<block_t>> prefetch;
+
+  direct_reader(int fd, const direct_io_options &options);
+
+  shared_ptr<block_t> read_direct(streamoff pos, size_t count) const;
+
+public:
+  direct_reader() = delete;
+  direct_reader(const direct_reader &) = delete;
+  direct_reader(direct_reader &&) = delete;
+  direct_reader &operator=(const direct_reader &) = delete;
+  direct_reader &operator=(direct_reader &&) = delete;
+
+  ~direct_reader();
+
+  // Returns null if the file cannot be opened for direct I/O
+  static shared_ptr<direct_reader> open(const string &filename,
+                                        const direct_io_options &options);
+
+  // Declare the blocks of the file, for reading ahead
+  void set_ranges(vector<pair<streamoff, size_t>> ranges);
+
+  // Read `count` bytes starting at position `pos`
+  shared_ptr<block_t> read(streamoff pos, size_t count);
+};
+
+// Write to a file with direct I/O, starting at a given position. Whole
+// aligned chunks are written with direct I/O in the background, the
+// misaligned head and tail fragments are written via the page cache.
+class direct_streambuf : public streambuf {
+  int fd;          // direct I/O, or -1 if not supported
+  int buffered_fd; // via the page cache
+  direct_io_options options;
+
+  // Chunks that are being filled or written
+  struct chunk_t {
+    shared_ptr<aligned_block_t> buffer;
+    future<void> written;
+  };
+  vector<chunk_t> chunks;
+  size_t current;         // chunk that is currently being filled
+  streamoff chunk_pos;    // file position of the current chunk (aligned)
+  streamoff valid_begin;  // file position where valid data begin
+
+  void submit();
+  void write_range(const unsigned char *buf, streamoff buf_pos,
+                   streamoff begin, streamoff end) const;
+
+protected:
+  virtual int_type overflow(int_type ch) override;
+  virtual pos_type seekoff(off_type off, ios_base::seekdir dir,
+                           ios_base::openmode which) override;
+
+public:
+  direct_streambuf() = delete;
+  direct_streambuf(const direct_streambuf &) = delete;
+  direct_streambuf(direct_streambuf &&) = delete;
+  direct_streambuf &operator=(const direct_streambuf &) = delete;
+  direct_streambuf &operator=(direct_streambuf &&) = delete;
+
+  direct_streambuf(const string &filename, streamoff pos,
+                   const direct_io_options &options);
+  virtual ~direct_streambuf();
+
+  // Write all remaining data and close the file. Returns the final file
+  // position.
+  streamoff close();
+};
+
+} // namespace ASDF
+
+#define ASDF_DIRECT_IO_HXX_DONE
+#endif // #ifndef ASDF_DIRECT_IO_HXX
+#ifndef ASDF_DIRECT_IO_HXX_DONE
+#error "Cyclic include depencency"
+#endif
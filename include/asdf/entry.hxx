@@ -4,6 +4,8 @@
 #include <asdf/datatype.hxx>
 #include <asdf/ndarray.hxx>
 #include <asdf/reference.hxx>
+#include <asdf/table.hxx>
+#include <asdf/tiled_ndarray.hxx>
 
 #include <yaml-cpp/yaml.h>
 
@@ -15,6 +17,7 @@
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <tuple>
@@ -37,6 +40,8 @@ enum class entry_type_t {
   software,
   history_entry,
   ndarray,
+  tiled_ndarray,
+  table,
   reference,
   sequence,
   group,
@@ -48,21 +53,47 @@ class null_entry;
 class bool_entry;
 class int_entry;
 class float_entry;
-class complex128_entry;
+class complex_entry;
 class string_entry;
 class software;
 // class history_entry;
 class ndarray_entry;
+class tiled_ndarray_entry;
+class table_entry;
 class reference_entry;
 class sequence;
 class group;
 
+// Visit entries without copying them or their values. Override the
+// member functions for the entry types of interest; the others do nothing.
+class entry_visitor {
+public:
+  virtual ~entry_visitor() {}
+
+  virtual void visit(const null_entry &) {}
+  virtual void visit(const bool_entry &) {}
+  virtual void visit(const int_entry &) {}
+  virtual void visit(const float_entry &) {}
+  virtual void visit(const complex_entry &) {}
+  virtual void visit(const string_entry &) {}
+  virtual void visit(const software &) {}
+  virtual void visit(const ndarray_entry &) {}
+  virtual void visit(const tiled_ndarray_entry &) {}
+  virtual void visit(const table_entry &) {}
+  virtual void visit(const reference_entry &) {}
+  virtual void visit(const sequence &) {}
+  virtual void visit(const group &) {}
+};
+
 class entry {
 public:
   virtual ~entry() {}
 
   virtual entry_type_t get_entry_type() const = 0;
 
+  // Call the visitor's member function for this entry's type
+  virtual void visit(entry_visitor &visitor) const = 0;
+
   virtual std::shared_ptr<entry> copy(const copy_state &cs) const = 0;
 
   virtual writer &to_yaml(writer &w) const = 0;
@@ -85,6 +116,10 @@ public:
     return {};
   }
   virtual std::shared_ptr<ndarray> get_maybe_ndarray() const { return {}; }
+  virtual std::shared_ptr<tiled_ndarray> get_maybe_tiled_ndarray() const {
+    return {};
+  }
+  virtual std::shared_ptr<table> get_maybe_table() const { return {}; }
   virtual std::shared_ptr<reference> get_maybe_reference() const { return {}; }
   virtual std::shared_ptr<std::vector<std::shared_ptr<entry>>>
   get_maybe_sequence() const {
@@ -117,6 +152,10 @@ public:
     return entry_type_t::null;
   }
 
+  virtual void visit(entry_visitor &visitor) const override {
+    visitor.visit(*this);
+  }
+
   virtual std::shared_ptr<entry> copy(const copy_state &cs) const override {
     return std::make_shared<null_entry>();
   }
@@ -153,6 +192,10 @@ public:
     return entry_type_t::bool8;
   }
 
+  virtual void visit(entry_visitor &visitor) const override {
+    visitor.visit(*this);
+  }
+
   virtual std::shared_ptr<entry> copy(const copy_state &cs) const override {
     return std::make_shared<bool_entry>(value);
   }
@@ -187,6 +230,10 @@ public:
     return entry_type_t::int64;
   }
 
+  virtual void visit(entry_visitor &visitor) const override {
+    visitor.visit(*this);
+  }
+
   virtual std::shared_ptr<entry> copy(const copy_state &cs) const override {
     return std::make_shared<int_entry>(value);
   }
@@ -223,6 +270,10 @@ public:
     return entry_type_t::float64;
   }
 
+  virtual void visit(entry_visitor &visitor) const override {
+    visitor.visit(*this);
+  }
+
   virtual std::shared_ptr<entry> copy(const copy_state &cs) const override {
     return std::make_shared<float_entry>(value);
   }
@@ -259,6 +310,10 @@ public:
     return entry_type_t::complex128;
   }
 
+  virtual void visit(entry_visitor &visitor) const override {
+    visitor.visit(*this);
+  }
+
   virtual std::shared_ptr<entry> copy(const copy_state &cs) const override {
     return std::make_shared<complex_entry>(value);
   }
@@ -296,6 +351,10 @@ public:
     return entry_type_t::string;
   }
 
+  virtual void visit(entry_visitor &visitor) const override {
+    visitor.visit(*this);
+  }
+
   virtual std::shared_ptr<entry> copy(const copy_state &cs) const override {
     return std::make_shared<string_entry>(value);
   }
@@ -309,7 +368,7 @@ public:
     return value;
   }
 
-  std::string get_string() const { return value; }
+  const std::string &get_string() const { return value; }
 };
 
 class software : public entry {
@@ -341,6 +400,10 @@ public:
     return entry_type_t::software;
   }
 
+  virtual void visit(entry_visitor &visitor) const override {
+    visitor.visit(*this);
+  }
+
   virtual std::shared_ptr<entry> copy(const copy_state &cs) const override {
     return std::make_shared<software>(cs, *this);
   }
@@ -355,10 +418,10 @@ public:
     return {{name, author, homepage, version}};
   }
 
-  std::string get_name() const { return name; }
-  std::string get_author() const { return author; }
-  std::string get_homepage() const { return homepage; }
-  std::string get_version() const { return version; }
+  const std::string &get_name() const { return name; }
+  const std::string &get_author() const { return author; }
+  const std::string &get_homepage() const { return homepage; }
+  const std::string &get_version() const { return version; }
   std::array<std::string, 4> get_software() const {
     return {name, author, homepage, version};
   }
@@ -391,6 +454,10 @@ public:
     return entry_type_t::ndarray;
   }
 
+  virtual void visit(entry_visitor &visitor) const override {
+    visitor.visit(*this);
+  }
+
   virtual std::shared_ptr<entry> copy(const copy_state &cs) const override {
     return std::make_shared<ndarray_entry>(cs, *this);
   }
@@ -404,7 +471,103 @@ public:
     return value;
   }
 
-  std::shared_ptr<ndarray> get_ndarray() const { return value; }
+  const std::shared_ptr<ndarray> &get_ndarray() const { return value; }
+};
+
+class tiled_ndarray_entry : public entry {
+  std::shared_ptr<tiled_ndarray> value;
+
+public:
+  using value_type = std::shared_ptr<tiled_ndarray>;
+
+  tiled_ndarray_entry() = delete;
+  tiled_ndarray_entry(const tiled_ndarray_entry &) = default;
+  tiled_ndarray_entry(tiled_ndarray_entry &&) = default;
+  tiled_ndarray_entry &operator=(const tiled_ndarray_entry &) = default;
+  tiled_ndarray_entry &operator=(tiled_ndarray_entry &&) = default;
+
+  virtual ~tiled_ndarray_entry() {}
+
+  tiled_ndarray_entry(std::shared_ptr<tiled_ndarray> value)
+      : value(std::move(value)) {}
+  tiled_ndarray_entry(tiled_ndarray value)
+      : tiled_ndarray_entry(std::make_shared<tiled_ndarray>(std::move(value))) {
+  }
+
+  tiled_ndarray_entry(const std::shared_ptr<reader_state> &rs,
+                      const YAML::Node node);
+  tiled_ndarray_entry(const copy_state &cs, const tiled_ndarray_entry &arr);
+
+  virtual entry_type_t get_entry_type() const override {
+    return entry_type_t::tiled_ndarray;
+  }
+
+  virtual void visit(entry_visitor &visitor) const override {
+    visitor.visit(*this);
+  }
+
+  virtual std::shared_ptr<entry> copy(const copy_state &cs) const override {
+    return std::make_shared<tiled_ndarray_entry>(cs, *this);
+  }
+
+  virtual writer &to_yaml(writer &w) const override;
+  friend writer &operator<<(writer &w, const tiled_ndarray_entry &ent) {
+    return ent.to_yaml(w);
+  }
+
+  virtual std::shared_ptr<tiled_ndarray>
+  get_maybe_tiled_ndarray() const override {
+    return value;
+  }
+
+  const std::shared_ptr<tiled_ndarray> &get_tiled_ndarray() const {
+    return value;
+  }
+};
+
+class table_entry : public entry {
+  std::shared_ptr<table> value;
+
+public:
+  using value_type = std::shared_ptr<table>;
+
+  table_entry() = delete;
+  table_entry(const table_entry &) = default;
+  table_entry(table_entry &&) = default;
+  table_entry &operator=(const table_entry &) = default;
+  table_entry &operator=(table_entry &&) = default;
+
+  virtual ~table_entry() {}
+
+  table_entry(std::shared_ptr<table> value) : value(std::move(value)) {}
+  table_entry(table value)
+      : table_entry(std::make_shared<table>(std::move(value))) {}
+
+  table_entry(const std::shared_ptr<reader_state> &rs, const YAML::Node node);
+  table_entry(const copy_state &cs, const table_entry &tab);
+
+  virtual entry_type_t get_entry_type() const override {
+    return entry_type_t::table;
+  }
+
+  virtual void visit(entry_visitor &visitor) const override {
+    visitor.visit(*this);
+  }
+
+  virtual std::shared_ptr<entry> copy(const copy_state &cs) const override {
+    return std::make_shared<table_entry>(cs, *this);
+  }
+
+  virtual writer &to_yaml(writer &w) const override;
+  friend writer &operator<<(writer &w, const table_entry &ent) {
+    return ent.to_yaml(w);
+  }
+
+  virtual std::shared_ptr<table> get_maybe_table() const override {
+    return value;
+  }
+
+  const std::shared_ptr<table> &get_table() const { return value; }
 };
 
 class reference_entry : public entry {
@@ -433,6 +596,10 @@ public:
     return entry_type_t::reference;
   }
 
+  virtual void visit(entry_visitor &visitor) const override {
+    visitor.visit(*this);
+  }
+
   virtual std::shared_ptr<entry> copy(const copy_state &cs) const override {
     return std::make_shared<reference_entry>(cs, *this);
   }
@@ -446,11 +613,28 @@ public:
     return value;
   }
 
-  std::shared_ptr<reference> get_reference() const { return value; }
+  const std::shared_ptr<reference> &get_reference() const { return value; }
+};
+
+// The part of the tree below a sequence or group that has not been read
+// yet. Entries read from a file are created only when they are accessed.
+// This is shared between copies of a sequence or group, as are the entries.
+struct lazy_node_t {
+  std::mutex mtx;
+  std::shared_ptr<reader_state> rs;
+  YAML::Node node;
+  bool complete = false;
+
+  lazy_node_t(const std::shared_ptr<reader_state> &rs, const YAML::Node &node)
+      : rs(rs), node(node) {}
 };
 
 class sequence : public entry {
+  // Unread entries are null
   std::shared_ptr<std::vector<std::shared_ptr<entry>>> entries;
+  std::shared_ptr<lazy_node_t> lazy;
+
+  void materialize() const;
 
 public:
   using value_type = std::shared_ptr<std::vector<std::shared_ptr<entry>>>;
@@ -484,6 +668,10 @@ public:
     return entry_type_t::sequence;
   }
 
+  virtual void visit(entry_visitor &visitor) const override {
+    visitor.visit(*this);
+  }
+
   virtual std::shared_ptr<entry> copy(const copy_state &cs) const override {
     return std::make_shared<sequence>(cs, *this);
   }
@@ -495,27 +683,38 @@ public:
 
   virtual std::shared_ptr<std::vector<std::shared_ptr<entry>>>
   get_maybe_sequence() const override {
-    return entries;
+    return get_sequence();
   }
 
   void push_back(std::shared_ptr<entry> value) {
+    materialize();
     entries->push_back(std::move(value));
   }
   template <typename T> void emplace_back(T &&value) {
-    entries->push_back(make_entry(std::forward<T>(value)));
+    push_back(make_entry(std::forward<T>(value)));
   }
 
   std::size_t size() const { return entries->size(); }
-  std::shared_ptr<entry> at(const std::size_t n) const {
-    return entries->at(n);
-  }
+  // Reads only the requested entry
+  std::shared_ptr<entry> at(const std::size_t n) const;
+  // Reads all entries
   std::shared_ptr<std::vector<std::shared_ptr<entry>>> get_sequence() const {
+    materialize();
     return entries;
   }
+  const std::vector<std::shared_ptr<entry>> &get_entries() const {
+    materialize();
+    return *entries;
+  }
 };
 
 class group : public entry, public std::enable_shared_from_this<group> {
+  // Holds only the entries that have been read
   std::shared_ptr<std::map<std::string, std::shared_ptr<entry>>> entries;
+  std::shared_ptr<lazy_node_t> lazy;
+
+  void materialize() const;
+  std::shared_ptr<entry> find(const std::string &key) const;
 
 public:
   using value_type =
@@ -550,6 +749,10 @@ public:
     return entry_type_t::group;
   }
 
+  virtual void visit(entry_visitor &visitor) const override {
+    visitor.visit(*this);
+  }
+
   virtual std::shared_ptr<entry> copy(const copy_state &cs) const override {
     return std::make_shared<group>(cs, *this);
   }
@@ -561,28 +764,34 @@ public:
 
   virtual std::shared_ptr<std::map<std::string, std::shared_ptr<entry>>>
   get_maybe_group() const override {
-    return entries;
+    return get_group();
   }
 
   void insert(std::pair<const std::string, std::shared_ptr<entry>> key_value) {
+    materialize();
     entries->insert(std::move(key_value));
   }
   void insert(const std::string &key, std::shared_ptr<entry> value) {
+    materialize();
     entries->emplace(key, std::move(value));
   }
   template <typename T> void emplace(const std::string &key, T &&value) {
-    entries->emplace(key, make_entry(std::forward<T>(value)));
-  }
-  std::size_t count(const std::string &key) const {
-    return entries->count(key);
-  }
-  std::shared_ptr<entry> at(const std::string &key) const {
-    return entries->at(key);
+    insert(key, make_entry(std::forward<T>(value)));
   }
+  // This does not read any entry
+  std::size_t count(const std::string &key) const;
+  // This reads only the requested entry
+  std::shared_ptr<entry> at(const std::string &key) const;
+  // Reads all entries
   std::shared_ptr<std::map<std::string, std::shared_ptr<entry>>>
   get_group() const {
+    materialize();
     return entries;
   }
+  const std::map<std::string, std::shared_ptr<entry>> &get_entries() const {
+    materialize();
+    return *entries;
+  }
 };
 
 inline std::shared_ptr<null_entry> make_entry(std::tuple<> value) {
@@ -613,6 +822,12 @@ inline std::shared_ptr<string_entry> make_entry(std::string value) {
 inline std::shared_ptr<ndarray_entry> make_entry(ndarray value) {
   return std::make_shared<ndarray_entry>(std::move(value));
 }
+inline std::shared_ptr<tiled_ndarray_entry> make_entry(tiled_ndarray value) {
+  return std::make_shared<tiled_ndarray_entry>(std::move(value));
+}
+inline std::shared_ptr<table_entry> make_entry(table value) {
+  return std::make_shared<table_entry>(std::move(value));
+}
 inline std::shared_ptr<reference_entry> make_entry(reference value) {
   return std::make_shared<reference_entry>(std::move(value));
 }
@@ -656,6 +871,13 @@ inline std::shared_ptr<ndarray_entry>
 make_entry(std::shared_ptr<ndarray> value) {
   return std::make_shared<ndarray_entry>(std::move(value));
 }
+inline std::shared_ptr<tiled_ndarray_entry>
+make_entry(std::shared_ptr<tiled_ndarray> value) {
+  return std::make_shared<tiled_ndarray_entry>(std::move(value));
+}
+inline std::shared_ptr<table_entry> make_entry(std::shared_ptr<table> value) {
+  return std::make_shared<table_entry>(std::move(value));
+}
 inline std::shared_ptr<reference_entry>
 make_entry(std::shared_ptr<reference> value) {
   return std::make_shared<reference_entry>(std::move(value));
@@ -675,6 +897,17 @@ inline std::shared_ptr<entry> make_entry(std::shared_ptr<entry> value) {
 std::shared_ptr<entry> make_entry(const std::shared_ptr<reader_state> &rs,
                                   const YAML::Node &node);
 
+// A plain scalar, classified as in `make_entry`: Booleans, integers, and
+// floating-point numbers are tried in this order, and quoted scalars are
+// always strings. For strings, the value is the node's scalar.
+struct yaml_scalar_t {
+  entry_type_t type; // bool8, int64, float64, or string
+  bool bool_value = false;
+  std::int64_t int_value = 0;
+  float64_t float_value = 0;
+};
+yaml_scalar_t classify_yaml_scalar(const YAML::Node &node);
+
 } // namespace ASDF
 
 #define ASDF_ENTRY_HXX_DONE
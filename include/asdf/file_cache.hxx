@@ -0,0 +1,82 @@
+#ifndef ASDF_FILE_CACHE_HXX
+#define ASDF_FILE_CACHE_HXX
+
+#include <asdf/io.hxx>
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace ASDF {
+using namespace std;
+
+// File cache
+
+// A process-wide cache of opened ASDF files, keyed by their canonical path.
+// Files that are opened via the cache (e.g. when resolving references to
+// external files) share their parsed tree and their blocks while they are
+// in use. The cache does not keep files alive. A file is opened anew if it
+// has been modified since, or if it is opened with different reader
+// options.
+//
+// The cache also limits the number of file descriptors that are held open
+// by streams that can be reopened by name. When the limit is reached, the
+// stream that was used least recently is closed; it is reopened
+// transparently when it is read again.
+class file_cache {
+  mutable mutex mtx;
+  struct file_t {
+    weak_ptr<reader_state> rs;
+    file_id_t file_id;
+    reader_options options;
+  };
+  multimap<string, file_t> files;
+
+  size_t max_open_files;
+  // Open streams, most recently used first
+  typedef list<pair<const shared_istream *, weak_ptr<shared_istream>>>
+      stream_list_t;
+  stream_list_t open_streams;
+  map<const shared_istream *, stream_list_t::iterator> open_stream_positions;
+
+  file_cache();
+
+public:
+  file_cache(const file_cache &) = delete;
+  file_cache(file_cache &&) = delete;
+  file_cache &operator=(const file_cache &) = delete;
+  file_cache &operator=(file_cache &&) = delete;
+
+  static file_cache &global();
+
+  // Open a file, or return the already opened file if it is unchanged and
+  // was opened with the same options
+  shared_ptr<reader_state> open(const string &filename,
+                                const reader_options &options = {});
+
+  // Forget all opened files. Files that are still in use remain open, but
+  // will not be shared with files opened later.
+  void clear();
+
+  // Maximum number of open streams; 0 means unlimited. The default is half
+  // of the process' limit on open file descriptors.
+  size_t get_max_open_files() const;
+  void set_max_open_files(size_t max_open_files);
+  size_t get_num_open_files() const;
+
+  // Called by shared_istream when a stream is used or closed
+  void touch(const shared_ptr<shared_istream> &psis);
+  void forget(const shared_istream *psis);
+};
+
+} // namespace ASDF
+
+#define ASDF_FILE_CACHE_HXX_DONE
+#endif // #ifndef ASDF_FILE_CACHE_HXX
+#ifndef ASDF_FILE_CACHE_HXX_DONE
+#error "Cyclic include depencency"
+#endif
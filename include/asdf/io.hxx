@@ -1,16 +1,21 @@
 #ifndef ASDF_IO_HXX
 #define ASDF_IO_HXX
 
+#include <asdf/collective.hxx>
 #include <asdf/memoized.hxx>
 
 #include <yaml-cpp/yaml.h>
 
+#include <array>
 #include <cassert>
 #include <complex>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -46,17 +51,180 @@ std::ostream &operator<<(std::ostream &os, block_format_t block_format);
 std::ostream &operator<<(std::ostream &os, compression_t compression);
 
 class block_t;
-struct block_info_t;
+
+// Information about a block
+// TODO: Rename block_t -> block_data_t, create new block_t as
+// tuple<memoized<block>, block_info>
+struct block_info_t {
+  array<unsigned char, 4> token;
+  uint16_t header_size;
+  int64_t header_read;
+  uint32_t flags;
+  array<unsigned char, 4> comp;
+  compression_t compression;
+  uint64_t allocated_space;
+  uint64_t used_space;
+  uint64_t data_space;
+  array<unsigned char, 16> checksum;
+};
+
+// A block that is ready to be written (e.g. it has already been
+// compressed), but whose position in the file is not yet known
+struct prepared_block_t {
+  block_info_t block_info;
+  shared_ptr<block_t> data;
+};
+
+// Direct I/O (`O_DIRECT`) bypasses the page cache. This avoids evicting
+// other data when huge files are read or written exactly once.
+bool have_direct_io();
+
+struct direct_io_options {
+  bool enable = false;
+  // Number of requests that are in flight at the same time
+  int queue_depth = 4;
+  // Size of each request (a multiple of the direct I/O alignment)
+  size_t chunk_size = 8 * 1024 * 1024;
+  // Read the next block in the background when a block is read
+  bool readahead = true;
+
+  bool operator==(const direct_io_options &other) const {
+    return enable == other.enable && queue_depth == other.queue_depth &&
+           chunk_size == other.chunk_size && readahead == other.readahead;
+  }
+  bool operator!=(const direct_io_options &other) const {
+    return !(*this == other);
+  }
+};
+
+// Batched block reads use io_uring if available, and a thread pool
+// calling `pread` otherwise
+bool have_liburing();
+
+struct batch_read_options {
+  // Number of blocks that are being read or waiting to be decoded
+  int queue_depth = 32;
+  // Number of threads that decode (e.g. decompress) blocks. If this is 0
+  // or less, use all hardware threads.
+  int nthreads = 0;
+
+  bool operator==(const batch_read_options &other) const {
+    return queue_depth == other.queue_depth && nthreads == other.nthreads;
+  }
+  bool operator!=(const batch_read_options &other) const {
+    return !(*this == other);
+  }
+};
+
+struct reader_options {
+  // Read blocks with direct I/O. If the file does not support direct I/O,
+  // it is read via the page cache instead.
+  direct_io_options direct_io;
+  // Read and decode all blocks in a batch when the file is opened, instead
+  // of reading each block when it is accessed
+  bool preload_blocks = false;
+  batch_read_options batch_read;
+
+  bool operator==(const reader_options &other) const {
+    return direct_io == other.direct_io &&
+           preload_blocks == other.preload_blocks &&
+           batch_read == other.batch_read;
+  }
+  bool operator!=(const reader_options &other) const {
+    return !(*this == other);
+  }
+};
+
+// Identifies the contents of a file by its device, inode, size, and
+// modification time, so that files that have been rewritten are noticed
+struct file_id_t {
+  uint64_t device;
+  uint64_t inode;
+  uint64_t size;
+  int64_t mtime;
+
+  // This is empty if the file cannot be accessed
+  static optional<file_id_t> get(const string &filename);
+
+  bool operator==(const file_id_t &other) const {
+    return device == other.device && inode == other.inode &&
+           size == other.size && mtime == other.mtime;
+  }
+  bool operator!=(const file_id_t &other) const { return !(*this == other); }
+};
+
+class direct_reader;
+
+// An input stream that is shared by all blocks of a file. Reading data at
+// a given position is serialized, so that blocks can be read from several
+// threads at the same time.
+class shared_istream : public enable_shared_from_this<shared_istream> {
+  shared_ptr<istream> pis;
+  // Set if the stream is a file stream that can be closed and reopened.
+  // This is the canonical path, as used by the file cache.
+  string filename;
+  optional<file_id_t> file_id;
+  mutex mtx;
+  shared_ptr<direct_reader> direct; // set if using direct I/O
+
+  // Reopen the stream if it was closed. The mutex must be held.
+  void reopen();
+
+public:
+  shared_istream() = delete;
+  shared_istream(const shared_istream &) = delete;
+  shared_istream(shared_istream &&) = delete;
+  shared_istream &operator=(const shared_istream &) = delete;
+  shared_istream &operator=(shared_istream &&) = delete;
+
+  shared_istream(shared_ptr<istream> pis1,
+                 shared_ptr<direct_reader> direct1 = nullptr,
+                 const string &filename1 = {});
+  ~shared_istream();
+
+  // Access the stream directly, e.g. to scan the block headers. No other
+  // thread may read from the stream at the same time.
+  istream &get_istream();
+
+  // Read `count` bytes starting at position `pos`
+  shared_ptr<block_t> read(streamoff pos, size_t count);
+
+  // Whether the stream can be closed and reopened by name
+  bool can_reopen() const { return !filename.empty(); }
+  // Close the stream if it can be reopened later
+  void close();
+};
 
 class reader_state {
   YAML::Node tree;
-  // TODO: Share "other_files" with other reader_state objects
   string filename;
-  map<string, shared_ptr<reader_state>> other_files;
+  reader_options options;
+
+  // Resolved references, indexed by their path. All prefixes of a
+  // resolved path are recorded as well, so that references into the same
+  // subtree only walk the remaining path elements.
+  struct reference_cache_t {
+    mutex mtx;
+    map<vector<string>, YAML::Node> nodes;
+  };
+  unique_ptr<reference_cache_t> reference_cache;
+
+  // External files that have been opened from this file, indexed by the
+  // name under which they are referenced. These are kept open as long as
+  // this file, so that repeated references into the same file do not
+  // parse it again. (The file cache only holds weak pointers.) Files that
+  // reference each other thus keep each other alive.
+  struct external_files_t {
+    mutex mtx;
+    map<string, shared_ptr<reader_state>> files;
+  };
+  unique_ptr<external_files_t> external_files;
 
   // TODO: Store only the file position
   vector<memoized<block_t>> blocks;
   vector<block_info_t> block_infos;
+  vector<streamoff> block_data_positions;
+  shared_ptr<shared_istream> psis;
 
 public:
   reader_state() = delete;
@@ -66,7 +234,8 @@ public:
   reader_state &operator=(reader_state &&) = default;
 
   reader_state(const YAML::Node &tree, const shared_ptr<istream> &pis,
-               const string &filename = {});
+               const string &filename = {},
+               const reader_options &options = {});
 
   memoized<block_t> get_block(int64_t index) const {
     assert(index >= 0);
@@ -75,6 +244,16 @@ public:
 
   block_info_t get_block_info(int64_t index) const;
 
+  // Read and decode several blocks at once. Blocks that have already been
+  // read are skipped.
+  void read_blocks(const vector<int64_t> &indices,
+                   const batch_read_options &options = {}) const;
+
+  // Open a file that is referenced from this file, e.g. an exploded file.
+  // Relative file names are relative to this file. The file remains open
+  // as long as this file is alive.
+  shared_ptr<reader_state> get_external_file(const string &filename) const;
+
   YAML::Node resolve_reference(const vector<string> &path) const;
 
   static pair<shared_ptr<reader_state>, YAML::Node>
@@ -91,14 +270,70 @@ struct copy_state {
   int compression_level;
 };
 
+struct writer_options {
+  // Number of blocks that are prepared (e.g. compressed) on a separate
+  // thread ahead of the block that is currently being written. 0 means
+  // that blocks are prepared and written one after the other.
+  int pipeline_depth = 0;
+  // Number of threads that prepare and write blocks when writing to a
+  // named file. If this is not 1, all blocks are first prepared in
+  // parallel, and are then written concurrently at their final offsets in
+  // the file. If this is 0 or less, use all hardware threads.
+  int nthreads = 1;
+  // Alignment (in bytes) of the data of every block in the file, e.g. 4096
+  // for page-aligned blocks. 0 or 1 means that blocks are not aligned.
+  // Blocks are aligned by padding their headers, and, if the alignment is
+  // too large for that, also by padding the preceding block or the tree.
+  uint64_t block_alignment = 0;
+  // Write blocks with direct I/O when writing to a named file. This does
+  // not apply when blocks are written in parallel.
+  direct_io_options direct_io;
+  // Inline arrays and sequences of numbers with more elements than this are
+  // written as binary blocks instead, since large amounts of YAML are slow
+  // to write and to read. A negative value means that there is no limit.
+  int64_t inline_threshold = -1;
+  // When writing to a named file, the blocks of arrays with more bytes than
+  // this are written into separate ASDF files next to the main file
+  // ("exploded" files). These files are written concurrently if nthreads
+  // is not 1. A negative value means that all blocks are written into the
+  // main file.
+  int64_t explode_threshold = -1;
+  // Write statistics (element count, range, NaN and infinity counts) next
+  // to every array that is stored in a block. Calculating them requires
+  // the data when the tree is written; data that were not in memory
+  // before are read again when their block is written. Statistics that
+  // were read from a file are always written. When writing collectively,
+  // the processes exchange the statistics of each array, which
+  // synchronizes them once per array.
+  bool write_statistics = false;
+  // Write a named file collectively with other processes. All processes
+  // must write the same tree. Arrays whose data are not valid in a process
+  // are written by another process. Exploded files are not supported.
+  shared_ptr<write_coordinator> coordinator;
+};
+
 class writer {
 
+  unique_ptr<ostream> owned_os; // set if the writer opened the file itself
   ostream &os;
+  string filename; // set if writing to a named file
   YAML::Emitter emitter;
+  writer_options options;
+
+  void write_prologue(const map<string, string> &tags);
+  void pad_tree();
+  void align_block(block_info_t &block_info, streamoff pos,
+                   bool have_next) const;
+  void write_blocks(ostream &bos, YAML::Emitter &index);
+  void write_blocks_parallel(YAML::Emitter &index);
+  void write_blocks_collective(YAML::Emitter &index);
+
+  // Tasks that prepare the blocks
+  vector<function<prepared_block_t()>> blocks;
+  // Tasks that prepare the blocks of exploded files, and their file names
+  vector<pair<string, function<prepared_block_t()>>> external_blocks;
 
-  // Tasks that write the blocks
-  // TODO: rename this variable
-  vector<function<void(ostream &os)>> tasks;
+  void write_external_blocks();
 
 public:
   writer(const writer &) = delete;
@@ -106,7 +341,10 @@ public:
   writer &operator=(const writer &) = delete;
   writer &operator=(writer &&) = delete;
 
-  writer(ostream &os, const map<string, string> &tags);
+  writer(ostream &os, const map<string, string> &tags,
+         const writer_options &options = {});
+  writer(const string &filename, const map<string, string> &tags,
+         const writer_options &options = {});
   ~writer();
 
   template <typename T> friend writer &operator<<(writer &w, const T &value) {
@@ -131,13 +369,30 @@ public:
     return w;
   }
 
-  // TODO: rename this function
-  int64_t add_task(function<void(ostream &)> &&task) {
-    tasks.push_back(std::move(task));
-    return tasks.size() - 1;
+  // `prepare` may be empty if the block is written collectively by another
+  // process
+  int64_t add_block(function<prepared_block_t()> &&prepare) {
+    assert(prepare || options.coordinator);
+    blocks.push_back(std::move(prepare));
+    return blocks.size() - 1;
   }
 
+  // Whether a block of the given size should be written into an exploded
+  // file
+  bool explode_block(int64_t nbytes) const {
+    return !filename.empty() && options.explode_threshold >= 0 &&
+           nbytes > options.explode_threshold;
+  }
+  // Add a block that is written into its own exploded file. Returns the
+  // name of that file, relative to the main file.
+  string add_external_block(function<prepared_block_t()> &&prepare);
+
+  const writer_options &get_options() const { return options; }
+
   void flush();
+  // Flush on a separate thread. The writer and its output stream must
+  // remain alive, and must not be used, until the future is ready.
+  future<void> flush_async();
 };
 
 } // namespace ASDF
@@ -10,8 +10,10 @@
 #include <array>
 #include <cassert>
 #include <cstddef>
+#include <cstdlib>
 #include <memory>
 #include <optional>
+#include <string>
 #include <tuple>
 #include <vector>
 
@@ -96,27 +98,79 @@ public:
   virtual void resize(size_t nbytes) override { assert(0); }
 };
 
-// Information about a block
-// TODO: Rename block_t -> block_data_t, create new block_t as
-// tuple<memoized<block>, block_info>
-struct block_info_t {
-  array<unsigned char, 4> token;
-  uint16_t header_size;
-  int64_t header_read;
-  uint32_t flags;
-  array<unsigned char, 4> comp;
-  compression_t compression;
-  uint64_t allocated_space;
-  uint64_t used_space;
-  uint64_t data_space;
-  array<unsigned char, 16> checksum;
+// A block with aligned storage, e.g. for direct I/O. The data start at an
+// offset into the storage.
+class aligned_block_t : public block_t {
+  struct free_deleter {
+    void operator()(unsigned char *ptr) const { free(ptr); }
+  };
+  unique_ptr<unsigned char, free_deleter> storage;
+  size_t capacity;
+  size_t offset;
+  size_t size;
+
+public:
+  aligned_block_t() = delete;
+
+  aligned_block_t(size_t alignment, size_t capacity, size_t offset = 0,
+                  size_t size = 0)
+      : storage(static_cast<unsigned char *>(aligned_alloc(
+            alignment, (capacity + alignment - 1) / alignment * alignment))),
+        capacity(capacity), offset(offset), size(size) {
+    assert(storage);
+    assert(offset + size <= capacity);
+  }
+
+  virtual ~aligned_block_t() {}
+
+  unsigned char *storage_ptr() { return storage.get(); }
+  size_t storage_size() const { return capacity; }
+
+  virtual const void *ptr() const override { return storage.get() + offset; }
+  virtual void *ptr() override { return storage.get() + offset; }
+  virtual size_t nbytes() const override { return size; }
+  virtual void reserve(size_t nbytes) override {
+    assert(offset + nbytes <= capacity);
+  }
+  virtual void resize(size_t nbytes) override {
+    assert(offset + nbytes <= capacity);
+    size = nbytes;
+  }
 };
 
+// Statistics
+
+// Statistics of the elements of an array. They are stored in the tree next
+// to the array, so that readers can skip arrays without reading their data.
+struct statistics_t {
+  int64_t count = 0;     // number of elements
+  int64_t nan_count = 0; // number of NaN elements
+  int64_t inf_count = 0; // number of infinite elements
+  // Range of all elements that are not NaN; not set if there are no such
+  // elements. Integers that are not exactly representable are rounded
+  // outwards.
+  std::optional<float64_t> min, max;
+};
+
+YAML::Node yaml_encode(const statistics_t &statistics);
+void yaml_decode(const YAML::Node &node, statistics_t &statistics);
+
+// Make the statistics of an array known to all processes that write a file
+// collectively. Only the process that holds the array's data passes its
+// statistics; all processes need to call this for the same arrays in the
+// same order.
+std::optional<statistics_t>
+exchange_statistics(write_coordinator &coordinator,
+                    const std::optional<statistics_t> &statistics);
+
 // ndarray
 
 class ndarray {
   memoized<block_t> mdata;
   std::optional<block_info_t> block_info; // TODO: remove duplicate information
+  // Set instead of `block_info` for arrays stored in exploded files, which
+  // are only opened when needed
+  memoized<block_info_t> exploded_block_info;
 
   block_format_t block_format;
   compression_t compression; // TODO: move to block_t
@@ -127,12 +181,28 @@ class ndarray {
   vector<int64_t> shape;
   int64_t offset;
   vector<int64_t> strides;
+  std::optional<statistics_t> statistics; // set when read from a file
 
-  void write_block(ostream &os) const;
+  prepared_block_t prepare_block() const;
 
 public:
+  // Size of the block magic token and the header size field
+  static constexpr size_t block_header_prefix_size = 6;
+  // Size of the block header fields that are read and written
+  static constexpr size_t block_header_fields_size = 48;
+
   static std::tuple<memoized<block_t>, block_info_t>
-  read_block(const shared_ptr<istream> &is);
+  read_block(const shared_ptr<shared_istream> &psis);
+  // Check and decompress the data of a block that has been read
+  static shared_ptr<block_t> decode_block(const shared_ptr<block_t> &inblock,
+                                          const block_info_t &block_info);
+  // Decode and check a block header, which needs to contain at least all
+  // fields that are read
+  static block_info_t decode_block_header(const unsigned char *header,
+                                          size_t size);
+  static vector<unsigned char>
+  encode_block_header(const block_info_t &block_info);
+  static void write_block(ostream &os, const prepared_block_t &block);
 
   ndarray() = delete;
   ndarray(const ndarray &) = default;
@@ -192,6 +262,14 @@ public:
                 host_byteorder(), std::move(shape1), offset,
                 std::move(strides1)) {}
 
+  // Create an array with a compound datatype from arrays for its fields
+  // ("struct of arrays" to "array of structs"). All arrays must have the
+  // same shape.
+  static ndarray join_fields(const vector<string> &names,
+                             const vector<shared_ptr<ndarray>> &fields,
+                             block_format_t block_format,
+                             compression_t compression, int compression_level);
+
   ndarray(const shared_ptr<reader_state> &rs, const YAML::Node &node);
   ndarray(const copy_state &cs, const ndarray &arr);
   writer &to_yaml(writer &w) const;
@@ -213,7 +291,26 @@ public:
   }
 
   // Only available after reading a file, not available while writing
-  std::optional<block_info_t> get_block_info() const { return block_info; }
+  std::optional<block_info_t> get_block_info() const {
+    if (!block_info && exploded_block_info.valid())
+      return *exploded_block_info.get();
+    return block_info;
+  }
+  // Only available after reading a file that contains statistics
+  const std::optional<statistics_t> &get_statistics() const {
+    return statistics;
+  }
+  // Calculate the statistics from the data. This is only possible for
+  // integer and real datatypes.
+  std::optional<statistics_t> calculate_statistics() const;
+
+  // A field of an array with a compound datatype, as a strided view that
+  // shares the data. If the field has a shape, it is appended to the shape
+  // of the array.
+  shared_ptr<ndarray> get_field(const string &name) const;
+  // Copy all fields of an array with a compound datatype into separate,
+  // contiguous arrays ("array of structs" to "struct of arrays")
+  vector<shared_ptr<ndarray>> split_fields() const;
 
   template <typename T> vector<T> get_data_vector() const {
     assert(datatype->is_scalar);
@@ -231,6 +328,7 @@ public:
   }
 
   shared_ptr<datatype_t> get_datatype() const { return datatype; }
+  byteorder_t get_byteorder() const { return byteorder; }
   vector<int64_t> get_shape() const { return shape; }
   int64_t get_offset() const { return offset; }
   vector<int64_t> get_strides() const { return strides; }
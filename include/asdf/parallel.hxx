@@ -0,0 +1,23 @@
+#ifndef ASDF_PARALLEL_HXX
+#define ASDF_PARALLEL_HXX
+
+#include <cstdint>
+#include <functional>
+
+namespace ASDF {
+using namespace std;
+
+// Parallelism
+
+// Call `f(i)` for all `0 <= i < n`, using up to `nthreads` threads. If
+// `nthreads <= 0`, use as many threads as there are hardware threads. If
+// any call throws an exception, the first such exception is rethrown.
+void parallel_for(int64_t n, int nthreads, const function<void(int64_t)> &f);
+
+} // namespace ASDF
+
+#define ASDF_PARALLEL_HXX_DONE
+#endif // #ifndef ASDF_PARALLEL_HXX
+#ifndef ASDF_PARALLEL_HXX_DONE
+#error "Cyclic include depencency"
+#endif
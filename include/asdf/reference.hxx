@@ -15,6 +15,9 @@ using namespace std;
 class reference {
   shared_ptr<reader_state> rs;
   string target;
+  // The target split into the file name and the path in that file,
+  // decoded once when the reference is created
+  pair<string, vector<string>> split_target;
 
 public:
   reference() = delete;
@@ -26,7 +29,9 @@ public:
   reference(string target1);
   reference(const string &base_target, const vector<string> &doc_path);
   string get_target() const { return target; }
-  pair<string, vector<string>> get_split_target() const;
+  const pair<string, vector<string>> &get_split_target() const {
+    return split_target;
+  }
 
   reference(const shared_ptr<reader_state> &rs, const YAML::Node &node);
   reference(const copy_state &cs, const reference &ref);
@@ -0,0 +1,111 @@
+#ifndef ASDF_SCAN_HXX
+#define ASDF_SCAN_HXX
+
+#include <asdf/datatype.hxx>
+#include <asdf/ndarray.hxx>
+#include <asdf/table.hxx>
+#include <asdf/tiled_ndarray.hxx>
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ASDF {
+using namespace std;
+
+// Scanning
+
+// A condition on the elements of an array. Elements are compared as
+// float64 values, so only integer and real datatypes can be scanned.
+// Integers whose magnitude exceeds 2^53 are rounded to float64 before they
+// are compared, so that e.g. `equal(2^53)` also matches 2^53 + 1.
+class predicate {
+public:
+  enum class kind_t { range, finite };
+
+private:
+  kind_t kind;
+  float64_t lo, hi;
+
+  predicate(kind_t kind, float64_t lo, float64_t hi)
+      : kind(kind), lo(lo), hi(hi) {}
+
+public:
+  predicate() = delete;
+  predicate(const predicate &) = default;
+  predicate(predicate &&) = default;
+  predicate &operator=(const predicate &) = default;
+  predicate &operator=(predicate &&) = default;
+
+  // Elements `x` with `lo <= x <= hi`. Nothing matches if `lo > hi`.
+  static predicate range(float64_t lo, float64_t hi);
+  // Elements `x` with `x == value`
+  static predicate equal(float64_t value);
+  // Elements `x` with `x > value`
+  static predicate greater(float64_t value);
+  // Elements `x` with `x < value`
+  static predicate less(float64_t value);
+  // Elements that are neither NaN nor infinite
+  static predicate finite();
+
+  bool operator()(float64_t x) const {
+    switch (kind) {
+    case kind_t::range:
+      // This is false for NaN
+      return lo <= x && x <= hi;
+    case kind_t::finite:
+      return isfinite(x);
+    }
+    return false;
+  }
+
+  // Whether an array with these statistics might contain matching elements
+  bool may_match(const statistics_t &statistics) const;
+  // Whether an array might contain matching elements, judging only from its
+  // statistics (if any), without reading its data
+  bool may_match(const ndarray &arr) const;
+};
+
+struct scan_options {
+  // Number of threads that decompress and scan arrays. If this is 0 or
+  // less, use all hardware threads.
+  int nthreads = 0;
+};
+
+// Find the indices of the elements of a one-dimensional array that match
+// a predicate. The indices are sorted. The data are not read if the
+// statistics of the array show that no element can match.
+vector<int64_t> scan(const ndarray &arr, const predicate &pred,
+                     const scan_options &options = {});
+
+// Find the indices of the elements of a one-dimensional tiled array that
+// match a predicate. The indices are sorted. Only the tiles whose
+// statistics do not rule out a match are read, and these are read in
+// parallel. Elements that are not covered by any tile do not match.
+vector<int64_t> scan(const tiled_ndarray &arr, const predicate &pred,
+                     const scan_options &options = {});
+
+struct table_scan_result_t {
+  // Rows in which the scanned column matches, in increasing order
+  vector<int64_t> rows;
+  // The projected columns, containing only the matching rows
+  table values;
+};
+
+// Find the rows of a table in which a column matches a predicate, and
+// gather these rows of the projected columns. The projected columns are
+// only read if there are matching rows.
+table_scan_result_t scan(const table &tab, const string &column,
+                         const predicate &pred,
+                         const vector<string> &projection = {},
+                         const scan_options &options = {});
+
+} // namespace ASDF
+
+#define ASDF_SCAN_HXX_DONE
+#endif // #ifndef ASDF_SCAN_HXX
+#ifndef ASDF_SCAN_HXX_DONE
+#error "Cyclic include depencency"
+#endif
@@ -5,8 +5,10 @@
 
 #include <yaml-cpp/yaml.h>
 
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace ASDF {
 using namespace std;
@@ -32,12 +34,32 @@ public:
     assert(data);
   }
 
+  // Refer to the user's data without copying them. The data must remain
+  // valid and unchanged until the column has been written.
+  template <typename T>
+  column(string name1, T *data1, int64_t nrows, string description1,
+         compression_t compression = compression_t::none,
+         int compression_level = 0)
+      : column(std::move(name1),
+               make_shared<ndarray>(
+                   make_constant_memoized(shared_ptr<block_t>(
+                       make_shared<ptr_block_t>(data1, nrows * sizeof(T)))),
+                   std::optional<block_info_t>(), block_format_t::block,
+                   compression, compression_level, vector<bool>(),
+                   make_shared<datatype_t>(get_scalar_type_id<T>()),
+                   host_byteorder(), vector<int64_t>{nrows}),
+               std::move(description1)) {}
+
   column(const shared_ptr<reader_state> &rs, const YAML::Node &node);
   column(const copy_state &cs, const column &col);
   writer &to_yaml(writer &w) const;
   friend writer &operator<<(writer &w, const column &col) {
     return col.to_yaml(w);
   }
+
+  const string &get_name() const { return name; }
+  const shared_ptr<ndarray> &get_data() const { return data; }
+  const string &get_description() const { return description; }
 };
 
 class table {
@@ -58,6 +80,19 @@ public:
   friend writer &operator<<(writer &w, const table &tab) {
     return tab.to_yaml(w);
   }
+
+  const vector<shared_ptr<column>> &get_columns() const { return columns; }
+  // Throws `out_of_range` if there is no such column
+  shared_ptr<column> get_column(const string &name) const;
+
+  // A table with only the named columns, in the given order. The columns
+  // are shared, not copied.
+  table select(const vector<string> &names) const;
+
+  // Read and decompress the data of all columns, using up to `nthreads`
+  // threads (see `parallel_for`). Otherwise, the data of each column are
+  // read when they are first accessed.
+  void read(int nthreads = 0) const;
 };
 
 } // namespace ASDF
@@ -0,0 +1,88 @@
+#ifndef ASDF_TILED_NDARRAY_HXX
+#define ASDF_TILED_NDARRAY_HXX
+
+#include <asdf/datatype.hxx>
+#include <asdf/io.hxx>
+#include <asdf/ndarray.hxx>
+#include <asdf/stl.hxx>
+
+#include <yaml-cpp/yaml.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ASDF {
+using namespace std;
+
+// Tiled ndarray
+
+// A tiled ndarray is a global array that is assembled from tiles. Each tile
+// is an ordinary ndarray (and is thus stored in its own block), together
+// with its position in the global array. Tiles may be produced by different
+// threads, or by different processes that write a file collectively (see
+// writer_options::coordinator). Tiles must not overlap; elements that are
+// not covered by any tile read as zero.
+//
+// Reading a region of a tiled ndarray only reads the tiles that overlap
+// with this region.
+class tiled_ndarray {
+public:
+  struct tile_t {
+    vector<int64_t> offset; // position in the global array
+    shared_ptr<ndarray> array;
+  };
+
+private:
+  shared_ptr<datatype_t> datatype;
+  vector<int64_t> shape;
+  vector<tile_t> tiles;
+
+public:
+  static constexpr const char *tag =
+      "tag:github.com/eschnett/asdf-cxx/tiled_ndarray-1.0.0";
+
+  tiled_ndarray() = delete;
+  tiled_ndarray(const tiled_ndarray &) = default;
+  tiled_ndarray(tiled_ndarray &&) = default;
+  tiled_ndarray &operator=(const tiled_ndarray &) = default;
+  tiled_ndarray &operator=(tiled_ndarray &&) = default;
+
+  tiled_ndarray(shared_ptr<datatype_t> datatype1, vector<int64_t> shape1);
+
+  // The tile must lie within the global array, must not overlap with other
+  // tiles, and must have the same datatype. Overlaps are only detected when
+  // the array is written.
+  void add_tile(vector<int64_t> offset, shared_ptr<ndarray> array);
+
+  tiled_ndarray(const shared_ptr<reader_state> &rs, const YAML::Node &node);
+  tiled_ndarray(const copy_state &cs, const tiled_ndarray &arr);
+  writer &to_yaml(writer &w) const;
+  friend writer &operator<<(writer &w, const tiled_ndarray &arr) {
+    return arr.to_yaml(w);
+  }
+
+  shared_ptr<datatype_t> get_datatype() const { return datatype; }
+  const vector<int64_t> &get_shape() const { return shape; }
+  const vector<tile_t> &get_tiles() const { return tiles; }
+
+  // Read the region `[begin, end)` into a contiguous array in row-major
+  // order and in host byte order. All fields of compound datatypes are
+  // converted to host byte order, even if the datatype specifies a byte
+  // order for them.
+  shared_ptr<block_t> read_region(const vector<int64_t> &begin,
+                                  const vector<int64_t> &end) const;
+  // Read the whole array
+  shared_ptr<block_t> read() const {
+    return read_region(vector<int64_t>(shape.size(), 0), shape);
+  }
+};
+
+} // namespace ASDF
+
+#define ASDF_TILED_NDARRAY_HXX_DONE
+#endif // #ifndef ASDF_TILED_NDARRAY_HXX
+#ifndef ASDF_TILED_NDARRAY_HXX_DONE
+#error "Cyclic include depencency"
+#endif
@@ -0,0 +1,31 @@
+#ifndef ASDF_YAML_PARSER_HXX
+#define ASDF_YAML_PARSER_HXX
+
+#include <yaml-cpp/yaml.h>
+
+#include <string>
+
+namespace ASDF {
+using namespace std;
+
+// YAML parsing
+
+// The parser front end is selected when building (see
+// `ASDF_USE_RAPIDYAML_PARSER` in CMakeLists.txt). yaml-cpp is the default.
+// All parsers produce a yaml-cpp node, with the same tags as yaml-cpp would
+// produce, so that each node is still allocated by yaml-cpp. Emitting YAML
+// always uses yaml-cpp.
+string yaml_parser_name();
+
+// Parse the first document of a YAML stream held in memory. The buffer
+// may be modified while parsing (in-situ parsing), but needs to stay
+// alive only during the call.
+YAML::Node yaml_parse(char *begin, char *end);
+
+} // namespace ASDF
+
+#define ASDF_YAML_PARSER_HXX_DONE
+#endif // #ifndef ASDF_YAML_PARSER_HXX
+#ifndef ASDF_YAML_PARSER_HXX_DONE
+#error "Cyclic include depencency"
+#endif
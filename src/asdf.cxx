@@ -1,11 +1,15 @@
 #include <asdf/asdf.hxx>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstdlib>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
 
 namespace ASDF {
 
@@ -63,64 +67,202 @@ writer &asdf::to_yaml(writer &w) const {
   return w;
 }
 
+namespace {
+// Find the end of the tree, i.e. the position just after the document end
+// marker "...". Returns `string::npos` if the end has not been found yet.
+size_t find_tree_end(const string &buf, size_t search_begin, bool at_eof) {
+  const string end_marker = "\n...\n";
+  search_begin = search_begin < end_marker.size() - 1
+                     ? 0
+                     : search_begin - (end_marker.size() - 1);
+  const size_t pos = buf.find(end_marker, search_begin);
+  if (pos != string::npos)
+    return pos + end_marker.size();
+  // The end marker might be the last line of the file
+  const string last_end_marker = "\n...";
+  if (at_eof && buf.size() >= last_end_marker.size() &&
+      buf.compare(buf.size() - last_end_marker.size(), last_end_marker.size(),
+                  last_end_marker) == 0)
+    return buf.size();
+  return string::npos;
+}
+} // namespace
+
 YAML::Node asdf::from_yaml(istream &is) {
-  ostringstream doc;
-  const array<unsigned char, 5> magic{'#', 'A', 'S', 'D', 'F'};
-  array<unsigned char, 5> header;
-  is.read(reinterpret_cast<char *>(header.data()), header.size());
-  if (!is || header != magic) {
-    cerr << "This is not an ASDF file\n";
-    if (is) {
-      cerr << "File header should be \"#ASDF\"; found instead \"";
-      for (auto ch : header)
-        if (ch == '\\' || ch == '"')
-          cerr << '\\' << ch;
-        else if (isprint(ch))
-          cerr << ch;
-        else
-          cerr << '\\' << oct << setw(3) << setfill('0') << int(ch);
-      cerr << "\"\n";
+  const streamoff tree_begin = is.tellg();
+  const bool seekable = tree_begin != -1;
+
+  // Read the tree in large chunks (or line by line if the stream cannot be
+  // repositioned afterwards) until the document end marker is found. This
+  // reads too much, and we step back when we are done.
+  string buf;
+  size_t tree_end = string::npos;
+  size_t chunk_size = 64 * 1024;
+  const size_t max_chunk_size = 16 * 1024 * 1024;
+  bool at_eof = false;
+  while (tree_end == string::npos && !at_eof) {
+    const size_t old_size = buf.size();
+    if (seekable) {
+      buf.resize(old_size + chunk_size);
+      is.read(&buf[old_size], chunk_size);
+      buf.resize(old_size + is.gcount());
+      chunk_size = min(2 * chunk_size, max_chunk_size);
+    } else {
+      string line;
+      getline(is, line);
+      buf.append(line);
+      if (is)
+        buf.push_back('\n');
     }
+    at_eof = !is;
+
+    if (old_size == 0) {
+      const array<char, 5> magic{'#', 'A', 'S', 'D', 'F'};
+      if (buf.size() < magic.size() ||
+          !equal(magic.begin(), magic.end(), buf.begin())) {
+        cerr << "This is not an ASDF file\n";
+        if (buf.size() >= magic.size()) {
+          cerr << "File header should be \"#ASDF\"; found instead \"";
+          for (size_t i = 0; i < magic.size(); ++i) {
+            const unsigned char ch = buf[i];
+            if (ch == '\\' || ch == '"')
+              cerr << '\\' << ch;
+            else if (isprint(ch))
+              cerr << ch;
+            else
+              cerr << '\\' << oct << setw(3) << setfill('0') << int(ch);
+          }
+          cerr << "\"\n";
+        }
+        exit(2);
+      }
+      // TODO: Check format version
+    }
+
+    tree_end = find_tree_end(buf, old_size, at_eof);
+  }
+  if (tree_end == string::npos) {
+    cerr << "Stream input error\n";
     exit(2);
   }
-  for (auto ch : header)
-    doc << ch;
-  // TODO: Check format version
-
-  // TODO: stream the file instead
-  while (is) {
-    string line;
-    getline(is, line);
-    doc << line << "\n";
-    if (line == "...")
-      return YAML::Load(doc.str());
+
+  // Position the stream just after the tree
+  if (seekable) {
+    is.clear();
+    is.seekg(tree_begin + streamoff(tree_end));
   }
-  cerr << "Stream input error\n";
-  exit(2);
+
+  // Parse the tree directly from the buffer
+  return yaml_parse(&buf[0], &buf[0] + tree_end);
 }
 
 asdf::asdf(const shared_ptr<istream> &pis, const string &filename,
-           const map<string, reader_t> &readers) {
+           const map<string, reader_t> &readers,
+           const reader_options &options) {
   auto node = from_yaml(*pis);
-  auto rs = make_shared<reader_state>(node, pis, filename);
+  auto rs = make_shared<reader_state>(node, pis, filename, options);
   *this = asdf(rs, node, readers);
 }
 
-asdf::asdf(const string &filename, const map<string, reader_t> &readers)
+asdf::asdf(const string &filename, const map<string, reader_t> &readers,
+           const reader_options &options)
     : asdf(make_shared<ifstream>(filename, ios::binary | ios::in), filename,
-           readers) {}
+           readers, options) {}
+
+namespace {
+// Collect the block indices of all arrays in a tree
+void collect_blocks(const YAML::Node &node, vector<int64_t> &indices) {
+  if (node.Tag() == "tag:stsci.edu:asdf/core/ndarray-1.0.0") {
+    // Arrays in exploded files are not prefetched
+    const YAML::Node &source = node["source"];
+    if (source && source.Tag() != "!")
+      if (const auto index = parse_yaml_int(source.Scalar()))
+        indices.push_back(*index);
+    return;
+  }
+  if (node.IsMap())
+    for (const auto &key_value : node)
+      collect_blocks(key_value.second, indices);
+  else if (node.IsSequence())
+    for (const auto &value : node)
+      collect_blocks(value, indices);
+}
+
+// Find the node at a path, or return an undefined node
+YAML::Node find_node(const YAML::Node &tree, const vector<string> &path) {
+  YAML::Node node(tree);
+  for (const auto &elem : path) {
+    const YAML::Node &parent = node;
+    if (parent.IsMap()) {
+      const YAML::Node child = parent[elem];
+      if (!child)
+        return YAML::Node(YAML::NodeType::Undefined);
+      node.reset(child);
+    } else if (parent.IsSequence()) {
+      const auto index = parse_yaml_int(elem);
+      if (!index || *index < 0 || size_t(*index) >= parent.size())
+        return YAML::Node(YAML::NodeType::Undefined);
+      node.reset(parent[size_t(*index)]);
+    } else {
+      return YAML::Node(YAML::NodeType::Undefined);
+    }
+  }
+  return node;
+}
+} // namespace
+
+void asdf::open_many(
+    const vector<string> &filenames,
+    const function<void(size_t n, const shared_ptr<asdf> &project)> &ready,
+    const open_many_options &options) {
+  mutex mtx;
+  parallel_for(filenames.size(), options.nthreads, [&](int64_t n) {
+    const string &filename = filenames.at(n);
+    const auto pis = make_shared<ifstream>(filename, ios::binary | ios::in);
+    assert(*pis);
+    const auto node = from_yaml(*pis);
+    const auto rs =
+        make_shared<reader_state>(node, pis, filename, options.reader);
+    if (!options.prefetch.empty()) {
+      vector<int64_t> indices;
+      for (const auto &path : options.prefetch)
+        if (const auto subtree = find_node(node, path))
+          collect_blocks(subtree, indices);
+      sort(indices.begin(), indices.end());
+      indices.erase(unique(indices.begin(), indices.end()), indices.end());
+      rs->read_blocks(indices, options.reader.batch_read);
+    }
+    const auto project = make_shared<asdf>(rs, node);
+    lock_guard<mutex> lock(mtx);
+    ready(n, project);
+  });
+}
+
+vector<shared_ptr<asdf>> asdf::open_many(const vector<string> &filenames,
+                                         const open_many_options &options) {
+  vector<shared_ptr<asdf>> projects(filenames.size());
+  open_many(
+      filenames,
+      [&](size_t n, const shared_ptr<asdf> &project) {
+        projects.at(n) = project;
+      },
+      options);
+  return projects;
+}
 
 asdf asdf::copy(const copy_state &cs) const { return asdf(cs, *this); }
 
-void asdf::write(ostream &os) const {
-  writer w(os, tags);
+void asdf::write(ostream &os, const writer_options &options) const {
+  writer w(os, tags, options);
   w << *this;
   w.flush();
 }
 
-void asdf::write(const string &filename) const {
-  ofstream os(filename, ios::binary | ios::trunc | ios::out);
-  write(os);
+void asdf::write(const string &filename,
+                 const writer_options &options) const {
+  writer w(filename, tags, options);
+  w << *this;
+  w.flush();
 }
 
 } // namespace ASDF
@@ -0,0 +1,250 @@
+#include <asdf/batch_io.hxx>
+
+#include <asdf/config.hxx>
+#include <asdf/parallel.hxx>
+
+#ifdef ASDF_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+namespace ASDF {
+
+// Batched reads
+
+namespace {
+
+// Alignment of the read buffers
+constexpr size_t buffer_alignment = 64;
+
+shared_ptr<aligned_block_t> make_buffer(size_t count) {
+  return make_shared<aligned_block_t>(buffer_alignment, count, 0, count);
+}
+
+void batch_read_pread(int fd, const vector<read_request_t> &requests,
+                      const batch_read_options &options,
+                      const read_done_t &done) {
+  // Each thread reads a block and then decodes it, so that reading and
+  // decoding different blocks overlap
+  parallel_for(requests.size(), options.nthreads, [&](int64_t n) {
+    const auto &request = requests.at(n);
+    const auto buffer = make_buffer(request.count);
+    unsigned char *const ptr = static_cast<unsigned char *>(buffer->ptr());
+    size_t nread = 0;
+    while (nread < request.count) {
+      const ssize_t nbytes = ::pread(fd, ptr + nread, request.count - nread,
+                                     request.pos + nread);
+      if (nbytes < 0) {
+        if (errno == EINTR)
+          continue;
+        throw system_error(errno, generic_category(), "pread");
+      }
+      // The file ended prematurely
+      assert(nbytes > 0);
+      nread += nbytes;
+    }
+    done(n, buffer);
+  });
+}
+
+#ifdef ASDF_HAVE_LIBURING
+// Returns false if io_uring is not available at run time
+bool batch_read_uring(int fd, const vector<read_request_t> &requests,
+                      const batch_read_options &options,
+                      const read_done_t &done) {
+  const size_t queue_depth = max(1, options.queue_depth);
+  io_uring ring;
+  if (io_uring_queue_init(queue_depth, &ring, 0) < 0)
+    return false;
+
+  // The length of a single read is limited
+  const size_t max_read_size = size_t(1) << 30;
+
+  const size_t nrequests = requests.size();
+  vector<shared_ptr<aligned_block_t>> buffers(nrequests);
+  vector<size_t> nread(nrequests, 0);
+
+  // Blocks that have been read, waiting to be decoded
+  mutex mtx;
+  condition_variable cond;
+  deque<size_t> ready;
+  size_t outstanding = 0; // blocks being read, waiting, or being decoded
+  bool finished = false;
+  exception_ptr error;
+
+  const auto decoder = [&]() {
+    for (;;) {
+      unique_lock<mutex> lock(mtx);
+      cond.wait(lock, [&]() { return !ready.empty() || finished; });
+      if (ready.empty())
+        break;
+      const size_t n = ready.front();
+      ready.pop_front();
+      lock.unlock();
+      try {
+        done(n, buffers.at(n));
+      } catch (...) {
+        lock.lock();
+        if (!error)
+          error = current_exception();
+        lock.unlock();
+      }
+      buffers.at(n).reset();
+      lock.lock();
+      --outstanding;
+      cond.notify_all();
+    }
+  };
+  int nthreads = options.nthreads;
+  if (nthreads <= 0)
+    nthreads = max(1U, thread::hardware_concurrency());
+  vector<thread> decoders;
+  for (int t = 0; t < nthreads; ++t)
+    decoders.emplace_back(decoder);
+
+  const auto make_ready = [&](size_t n) {
+    lock_guard<mutex> lock(mtx);
+    ready.push_back(n);
+    cond.notify_all();
+  };
+  // Submit a read for the next part of a request
+  size_t inflight = 0;
+  const auto prepare_read = [&](size_t n) {
+    const auto &request = requests.at(n);
+    io_uring_sqe *const sqe = io_uring_get_sqe(&ring);
+    assert(sqe);
+    unsigned char *const ptr =
+        static_cast<unsigned char *>(buffers.at(n)->ptr());
+    const size_t count = min(request.count - nread.at(n), max_read_size);
+    io_uring_prep_read(sqe, fd, ptr + nread.at(n), count,
+                       request.pos + nread.at(n));
+    io_uring_sqe_set_data(sqe, reinterpret_cast<void *>(uintptr_t(n)));
+    ++inflight;
+  };
+
+  size_t next = 0;
+  for (;;) {
+    // Start reading more blocks while there is room in the queue
+    bool failed;
+    {
+      unique_lock<mutex> lock(mtx);
+      if (inflight == 0 && next < nrequests)
+        cond.wait(lock,
+                  [&]() { return outstanding < queue_depth || error; });
+      failed = bool(error);
+      while (!failed && next < nrequests && outstanding < queue_depth) {
+        const size_t n = next++;
+        ++outstanding;
+        buffers.at(n) = make_buffer(requests.at(n).count);
+        if (requests.at(n).count == 0) {
+          ready.push_back(n);
+          cond.notify_all();
+        } else {
+          prepare_read(n);
+        }
+      }
+    }
+    if (failed)
+      next = nrequests;
+    if (inflight == 0) {
+      if (next == nrequests)
+        break;
+      continue;
+    }
+    io_uring_submit(&ring);
+
+    // Wait for a read to complete
+    io_uring_cqe *cqe;
+    const int ierr = io_uring_wait_cqe(&ring, &cqe);
+    if (ierr == -EINTR)
+      continue;
+    if (ierr < 0) {
+      lock_guard<mutex> lock(mtx);
+      if (!error)
+        error = make_exception_ptr(
+            system_error(-ierr, generic_category(), "io_uring_wait_cqe"));
+      // Do not submit anything more; drain the ring below
+      break;
+    }
+    const size_t n = uintptr_t(io_uring_cqe_get_data(cqe));
+    const int res = cqe->res;
+    io_uring_cqe_seen(&ring, cqe);
+    --inflight;
+
+    if (res == -EINTR || res == -EAGAIN) {
+      prepare_read(n);
+    } else if (res <= 0) {
+      lock_guard<mutex> lock(mtx);
+      if (!error)
+        error = make_exception_ptr(
+            res < 0 ? system_error(-res, generic_category(), "io_uring read")
+                    : system_error(EIO, generic_category(),
+                                   "io_uring read: unexpected end of file"));
+      --outstanding;
+      next = nrequests;
+    } else {
+      nread.at(n) += res;
+      if (nread.at(n) < requests.at(n).count)
+        prepare_read(n); // short read
+      else
+        make_ready(n);
+    }
+  }
+
+  // Wait for the reads that are still in flight, since they write into our
+  // buffers. If waiting fails again, the buffers are leaked instead of being
+  // freed while the kernel might still write into them.
+  bool leak_buffers = false;
+  while (inflight > 0) {
+    io_uring_cqe *cqe;
+    const int ierr = io_uring_wait_cqe(&ring, &cqe);
+    if (ierr == -EINTR)
+      continue;
+    if (ierr < 0) {
+      leak_buffers = true;
+      break;
+    }
+    io_uring_cqe_seen(&ring, cqe);
+    --inflight;
+  }
+
+  {
+    lock_guard<mutex> lock(mtx);
+    finished = true;
+    cond.notify_all();
+  }
+  for (auto &thr : decoders)
+    thr.join();
+  if (leak_buffers)
+    new vector<shared_ptr<aligned_block_t>>(std::move(buffers));
+  io_uring_queue_exit(&ring);
+  if (error)
+    rethrow_exception(error);
+  return true;
+}
+#endif
+
+} // namespace
+
+void batch_read(int fd, const vector<read_request_t> &requests,
+                const batch_read_options &options, const read_done_t &done) {
+#ifdef ASDF_HAVE_LIBURING
+  if (batch_read_uring(fd, requests, options, done))
+    return;
+#endif
+  batch_read_pread(fd, requests, options, done);
+}
+
+} // namespace ASDF
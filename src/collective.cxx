@@ -0,0 +1,90 @@
+#include <asdf/collective.hxx>
+
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <system_error>
+
+namespace ASDF {
+
+// Collective writing
+
+// The state lives in an anonymous shared mapping, followed by the values
+// that are being reduced
+struct shared_memory_coordinator::shared_state_t {
+  pthread_barrier_t barrier;
+  pthread_mutex_t mutex;
+  size_t max_values;
+
+  uint64_t *values() { return reinterpret_cast<uint64_t *>(this + 1); }
+};
+
+shared_memory_coordinator::shared_memory_coordinator(int nprocs,
+                                                     size_t max_values)
+    : state(nullptr), state_size(0), nprocs(nprocs), my_rank(-1) {
+  assert(nprocs >= 1);
+  assert(max_values >= 1);
+  state_size = sizeof(shared_state_t) + max_values * sizeof(uint64_t);
+  void *const ptr = mmap(nullptr, state_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED)
+    throw system_error(errno, generic_category(), "mmap");
+  state = static_cast<shared_state_t *>(ptr);
+  state->max_values = max_values;
+
+  pthread_barrierattr_t barrier_attr;
+  int ierr = pthread_barrierattr_init(&barrier_attr);
+  assert(!ierr);
+  ierr = pthread_barrierattr_setpshared(&barrier_attr, PTHREAD_PROCESS_SHARED);
+  assert(!ierr);
+  ierr = pthread_barrier_init(&state->barrier, &barrier_attr, nprocs);
+  assert(!ierr);
+  pthread_barrierattr_destroy(&barrier_attr);
+
+  pthread_mutexattr_t mutex_attr;
+  ierr = pthread_mutexattr_init(&mutex_attr);
+  assert(!ierr);
+  ierr = pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+  assert(!ierr);
+  ierr = pthread_mutex_init(&state->mutex, &mutex_attr);
+  assert(!ierr);
+  pthread_mutexattr_destroy(&mutex_attr);
+}
+
+shared_memory_coordinator::~shared_memory_coordinator() {
+  // The barrier and mutex are not destroyed, since other processes might
+  // still use them; unmapping only affects this process
+  munmap(state, state_size);
+}
+
+void shared_memory_coordinator::select_rank(int rank) {
+  assert(rank >= 0 && rank < nprocs);
+  my_rank = rank;
+}
+
+void shared_memory_coordinator::allreduce_sum(vector<uint64_t> &values) {
+  assert(my_rank >= 0);
+  const size_t max_values = state->max_values;
+  uint64_t *const sum = state->values();
+  // Reduce in chunks that fit into the shared state. All processes pass
+  // the same number of values, and thus the same number of chunks.
+  for (size_t pos = 0; pos == 0 || pos < values.size(); pos += max_values) {
+    const size_t count = min(max_values, values.size() - pos);
+    // Wait until all processes have read the result of the previous chunk
+    pthread_barrier_wait(&state->barrier);
+    if (my_rank == 0)
+      fill(sum, sum + count, 0);
+    pthread_barrier_wait(&state->barrier);
+    pthread_mutex_lock(&state->mutex);
+    for (size_t n = 0; n < count; ++n)
+      sum[n] += values[pos + n];
+    pthread_mutex_unlock(&state->mutex);
+    pthread_barrier_wait(&state->barrier);
+    copy(sum, sum + count, values.begin() + pos);
+  }
+}
+
+} // namespace ASDF
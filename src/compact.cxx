@@ -0,0 +1,301 @@
+#include <asdf/compact.hxx>
+
+#include <asdf/datatype.hxx>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+
+namespace ASDF {
+
+// Compact entry trees
+
+uint32_t compact_tree::intern(string_view key) {
+  const auto iter = key_ids.find(key);
+  if (iter != key_ids.end())
+    return iter->second;
+  assert(key_names.size() < numeric_limits<uint32_t>::max());
+  const uint32_t id = key_names.size();
+  key_names.emplace_back(key);
+  key_ids.emplace(key_names.back(), id);
+  return id;
+}
+
+uint32_t compact_tree::add(const shared_ptr<entry> &ent) {
+  assert(ent);
+  assert(nodes.size() < numeric_limits<uint32_t>::max());
+  const uint32_t index = nodes.size();
+  node_t node;
+  node.type = ent->get_entry_type();
+  node.size = 0;
+  node.pos = 0;
+  switch (node.type) {
+  case entry_type_t::null:
+    break;
+  case entry_type_t::bool8:
+    node.bool_value = *ent->get_maybe_bool();
+    break;
+  case entry_type_t::int64:
+    node.int_value = *ent->get_maybe_int();
+    break;
+  case entry_type_t::float64:
+    node.float_value = *ent->get_maybe_float();
+    break;
+  case entry_type_t::string: {
+    const string str = *ent->get_maybe_string();
+    assert(str.size() <= numeric_limits<uint32_t>::max());
+    node.size = str.size();
+    node.pos = text.size();
+    text.append(str);
+    break;
+  }
+  case entry_type_t::sequence:
+  case entry_type_t::group:
+    // The children are added below
+    break;
+  default:
+    node.pos = objects.size();
+    objects.push_back(ent);
+    break;
+  }
+  nodes.push_back(node);
+
+  if (node.type == entry_type_t::sequence) {
+    const auto &values = *ent->get_maybe_sequence();
+    const size_t pos = children.size();
+    // Reserve the children's slots first so that they are contiguous
+    children.resize(pos + values.size());
+    keys.resize(pos + values.size());
+    for (size_t n = 0; n < values.size(); ++n) {
+      const uint32_t child = add(values[n]);
+      children[pos + n] = child;
+    }
+    nodes[index].size = values.size();
+    nodes[index].pos = pos;
+  } else if (node.type == entry_type_t::group) {
+    // std::map keeps the entries sorted by key
+    const auto &values = *ent->get_maybe_group();
+    const size_t pos = children.size();
+    children.resize(pos + values.size());
+    keys.resize(pos + values.size());
+    size_t n = 0;
+    for (const auto &[key, value] : values) {
+      const uint32_t key_id = intern(key);
+      keys[pos + n] = key_id;
+      const uint32_t child = add(value);
+      children[pos + n] = child;
+      ++n;
+    }
+    nodes[index].size = values.size();
+    nodes[index].pos = pos;
+  }
+  return index;
+}
+
+uint32_t compact_tree::add(const shared_ptr<reader_state> &rs,
+                           const YAML::Node &node) {
+  assert(node.IsDefined());
+  // Nodes with a tag and references are kept as entries
+  const auto tag = node.Tag();
+  if (!(tag.empty() || tag == "?" || tag == "!") ||
+      (node.IsMap() && node["$ref"]))
+    return add(ASDF::make_entry(rs, node));
+
+  assert(nodes.size() < numeric_limits<uint32_t>::max());
+  const uint32_t index = nodes.size();
+  node_t item;
+  item.size = 0;
+  item.pos = 0;
+  if (node.IsNull()) {
+    item.type = entry_type_t::null;
+  } else if (node.IsScalar()) {
+    const auto scalar = classify_yaml_scalar(node);
+    item.type = scalar.type;
+    switch (scalar.type) {
+    case entry_type_t::bool8:
+      item.bool_value = scalar.bool_value;
+      break;
+    case entry_type_t::int64:
+      item.int_value = scalar.int_value;
+      break;
+    case entry_type_t::float64:
+      item.float_value = scalar.float_value;
+      break;
+    default: {
+      const string &str = node.Scalar();
+      assert(str.size() <= numeric_limits<uint32_t>::max());
+      item.size = str.size();
+      item.pos = text.size();
+      text.append(str);
+      break;
+    }
+    }
+  } else if (node.IsSequence()) {
+    item.type = entry_type_t::sequence;
+  } else {
+    assert(node.IsMap());
+    item.type = entry_type_t::group;
+  }
+  nodes.push_back(item);
+
+  if (item.type == entry_type_t::sequence) {
+    const size_t size = node.size();
+    const size_t pos = children.size();
+    // Reserve the children's slots first so that they are contiguous
+    children.resize(pos + size);
+    keys.resize(pos + size);
+    for (size_t n = 0; n < size; ++n) {
+      const uint32_t child = add(rs, node[n]);
+      children[pos + n] = child;
+    }
+    nodes[index].size = size;
+    nodes[index].pos = pos;
+  } else if (item.type == entry_type_t::group) {
+    // Sort the entries by key. As in a group, the first of several entries
+    // with the same key wins. (Sort indices, since assigning to a
+    // YAML::Node modifies the node it refers to.)
+    vector<YAML::Node> values;
+    vector<pair<string, size_t>> order;
+    for (const auto &key_value : node) {
+      order.emplace_back(key_value.first.Scalar(), values.size());
+      values.push_back(key_value.second);
+    }
+    stable_sort(order.begin(), order.end(),
+                [](const auto &x, const auto &y) { return x.first < y.first; });
+    order.erase(unique(order.begin(), order.end(),
+                       [](const auto &x, const auto &y) {
+                         return x.first == y.first;
+                       }),
+                order.end());
+    const size_t pos = children.size();
+    children.resize(pos + order.size());
+    keys.resize(pos + order.size());
+    for (size_t n = 0; n < order.size(); ++n) {
+      keys[pos + n] = intern(order[n].first);
+      const uint32_t child = add(rs, values[order[n].second]);
+      children[pos + n] = child;
+    }
+    nodes[index].size = order.size();
+    nodes[index].pos = pos;
+  }
+  return index;
+}
+
+compact_tree::compact_tree(const shared_ptr<entry> &root) { add(root); }
+
+compact_tree::compact_tree(const shared_ptr<reader_state> &rs,
+                           const YAML::Node &root) {
+  add(rs, root);
+}
+
+shared_ptr<entry> compact_tree::make_entry(uint32_t index) const {
+  const node_t &node = nodes.at(index);
+  switch (node.type) {
+  case entry_type_t::null:
+    return make_shared<null_entry>();
+  case entry_type_t::bool8:
+    return make_shared<bool_entry>(node.bool_value);
+  case entry_type_t::int64:
+    return make_shared<int_entry>(node.int_value);
+  case entry_type_t::float64:
+    return make_shared<float_entry>(node.float_value);
+  case entry_type_t::string:
+    return make_shared<string_entry>(text.substr(node.pos, node.size));
+  case entry_type_t::sequence: {
+    vector<shared_ptr<entry>> values;
+    values.reserve(node.size);
+    for (uint32_t n = 0; n < node.size; ++n)
+      values.push_back(make_entry(children[node.pos + n]));
+    return make_shared<sequence>(std::move(values));
+  }
+  case entry_type_t::group: {
+    map<string, shared_ptr<entry>> values;
+    for (uint32_t n = 0; n < node.size; ++n)
+      values.emplace_hint(values.end(), key_names[keys[node.pos + n]],
+                          make_entry(children[node.pos + n]));
+    return make_shared<group>(std::move(values));
+  }
+  default:
+    return objects.at(node.pos);
+  }
+}
+
+entry_type_t compact_entry::get_entry_type() const {
+  return tree->nodes[index].type;
+}
+
+bool compact_entry::get_bool() const {
+  const auto &node = tree->nodes[index];
+  assert(node.type == entry_type_t::bool8);
+  return node.bool_value;
+}
+
+int64_t compact_entry::get_int() const {
+  const auto &node = tree->nodes[index];
+  assert(node.type == entry_type_t::int64);
+  return node.int_value;
+}
+
+float64_t compact_entry::get_float() const {
+  const auto &node = tree->nodes[index];
+  assert(node.type == entry_type_t::float64);
+  return node.float_value;
+}
+
+string_view compact_entry::get_string() const {
+  const auto &node = tree->nodes[index];
+  assert(node.type == entry_type_t::string);
+  return string_view(tree->text).substr(node.pos, node.size);
+}
+
+size_t compact_entry::size() const {
+  const auto &node = tree->nodes[index];
+  assert(node.type == entry_type_t::sequence ||
+         node.type == entry_type_t::group);
+  return node.size;
+}
+
+compact_entry compact_entry::at(size_t n) const {
+  const auto &node = tree->nodes[index];
+  assert(node.type == entry_type_t::sequence ||
+         node.type == entry_type_t::group);
+  if (n >= node.size)
+    throw out_of_range("compact_entry::at: index out of range");
+  return compact_entry(tree, tree->children[node.pos + n]);
+}
+
+string_view compact_entry::key(size_t n) const {
+  const auto &node = tree->nodes[index];
+  assert(node.type == entry_type_t::group);
+  assert(n < node.size);
+  return tree->key_names[tree->keys[node.pos + n]];
+}
+
+optional<compact_entry> compact_entry::find(string_view key) const {
+  const auto &node = tree->nodes[index];
+  assert(node.type == entry_type_t::group);
+  const auto begin = tree->keys.begin() + node.pos;
+  const auto end = begin + node.size;
+  const auto iter =
+      lower_bound(begin, end, key, [&](uint32_t key_id, string_view key) {
+        return string_view(tree->key_names[key_id]) < key;
+      });
+  if (iter == end || tree->key_names[*iter] != key)
+    return {};
+  return compact_entry(tree, tree->children[iter - tree->keys.begin()]);
+}
+
+compact_entry compact_entry::at(string_view key) const {
+  const auto value = find(key);
+  if (!value)
+    throw out_of_range("compact_entry::at: key \"" + string(key) +
+                       "\" not found");
+  return *value;
+}
+
+shared_ptr<entry> compact_entry::get_entry() const {
+  return tree->make_entry(index);
+}
+
+} // namespace ASDF
@@ -1,6 +1,10 @@
 #include <asdf/config.hxx>
 #include <asdf/datatype.hxx>
+#include <asdf/stl.hxx>
 
+#include <cctype>
+#include <charconv>
+#include <cmath>
 #include <limits>
 #include <regex>
 #include <stdexcept>
@@ -300,6 +304,73 @@ void yaml_decode(const YAML::Node &node, float32_t &val) {
 void yaml_decode(const YAML::Node &node, float64_t &val) {
   val = node.as<float64_t>();
 }
+optional<bool8_t> parse_yaml_bool(string_view str) {
+  for (const string_view name :
+       {"y", "Y", "yes", "Yes", "YES", "true", "True", "TRUE", "on", "On",
+        "ON"})
+    if (str == name)
+      return true;
+  for (const string_view name :
+       {"n", "N", "no", "No", "NO", "false", "False", "FALSE", "off", "Off",
+        "OFF"})
+    if (str == name)
+      return false;
+  return {};
+}
+
+optional<int64_t> parse_yaml_int(string_view str) {
+  bool negative = false;
+  if (!str.empty() && (str[0] == '+' || str[0] == '-')) {
+    negative = str[0] == '-';
+    str.remove_prefix(1);
+  }
+  int base = 10;
+  if (str.size() > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+    base = 16;
+    str.remove_prefix(2);
+  } else if (str.size() > 2 && str[0] == '0' &&
+             (str[1] == 'b' || str[1] == 'B')) {
+    base = 2;
+    str.remove_prefix(2);
+  } else if (str.size() > 1 && str[0] == '0') {
+    base = 8;
+    str.remove_prefix(1);
+  }
+  const char *const end = str.data() + str.size();
+  uint64_t magnitude;
+  const auto [ptr, ec] = from_chars(str.data(), end, magnitude, base);
+  if (ec != errc() || ptr != end)
+    return {};
+  const uint64_t max_magnitude =
+      uint64_t(numeric_limits<int64_t>::max()) + negative;
+  if (magnitude > max_magnitude)
+    return {};
+  return negative ? int64_t(-magnitude) : int64_t(magnitude);
+}
+
+optional<float64_t> parse_yaml_float(string_view str) {
+  bool negative = false;
+  if (!str.empty() && (str[0] == '+' || str[0] == '-')) {
+    negative = str[0] == '-';
+    str.remove_prefix(1);
+  }
+  if (str == ".inf" || str == ".Inf" || str == ".INF")
+    return negative ? -numeric_limits<float64_t>::infinity()
+                    : numeric_limits<float64_t>::infinity();
+  if (str == ".nan" || str == ".NaN" || str == ".NAN")
+    return numeric_limits<float64_t>::quiet_NaN();
+  // `from_chars` would also accept "inf" and "nan"
+  if (str.empty() ||
+      !(isdigit(static_cast<unsigned char>(str[0])) || str[0] == '.'))
+    return {};
+  const char *const end = str.data() + str.size();
+  float64_t value;
+  const auto [ptr, ec] = from_chars(str.data(), end, value);
+  if (ec != errc() || ptr != end)
+    return {};
+  return negative ? -value : value;
+}
+
 namespace {
 template <typename T>
 void yaml_decode_complex(const YAML::Node &node, complex<T> &val) {
@@ -605,6 +676,55 @@ YAML::Node emit_scalar(const unsigned char *data,
   return node;
 }
 
+namespace {
+template <typename T> string format_number(T val) {
+  if constexpr (is_floating_point_v<T>) {
+    if (isinf(val))
+      return val > 0 ? ".inf" : "-.inf";
+    if (isnan(val))
+      return ".nan";
+  }
+  char buf[64];
+  const auto [ptr, ec] = to_chars(buf, buf + sizeof buf, val);
+  assert(ec == errc());
+  return string(buf, ptr);
+}
+} // namespace
+
+string format_scalar(const unsigned char *data,
+                     scalar_type_id_t scalar_type_id, byteorder_t byteorder) {
+  switch (scalar_type_id) {
+  case id_bool8:
+    return xtoh<unsigned char>(data, byteorder) ? "true" : "false";
+  case id_int8:
+    return format_number(int(xtoh<int8_t>(data, byteorder)));
+  case id_int16:
+    return format_number(xtoh<int16_t>(data, byteorder));
+  case id_int32:
+    return format_number(xtoh<int32_t>(data, byteorder));
+  case id_int64:
+    return format_number(xtoh<int64_t>(data, byteorder));
+  case id_uint8:
+    return format_number((unsigned int)(xtoh<uint8_t>(data, byteorder)));
+  case id_uint16:
+    return format_number(xtoh<uint16_t>(data, byteorder));
+  case id_uint32:
+    return format_number(xtoh<uint32_t>(data, byteorder));
+  case id_uint64:
+    return format_number(xtoh<uint64_t>(data, byteorder));
+#ifdef ASDF_HAVE_FLOAT16
+  case id_float16:
+    return format_number(float32_t(xtoh<float16_t>(data, byteorder)));
+#endif
+  case id_float32:
+    return format_number(xtoh<float32_t>(data, byteorder));
+  case id_float64:
+    return format_number(xtoh<float64_t>(data, byteorder));
+  default:
+    return {};
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 // Datatypes
@@ -615,14 +735,29 @@ field_t::field_t(string name, shared_ptr<datatype_t> datatype,
     : name(std::move(name)), datatype(std::move(datatype)),
       have_byteorder(have_byteorder), byteorder(byteorder),
       shape(std::move(shape)) {
-  assert(datatype);
+  assert(this->datatype);
+  for (const auto n : this->shape)
+    assert(n >= 0);
 }
 
 field_t::field_t(const shared_ptr<reader_state> &rs, const YAML::Node &node) {
-  assert(0);
+  assert(node.IsMap());
+  if (node["name"].IsDefined())
+    name = node["name"].Scalar();
+  datatype = make_shared<datatype_t>(rs, node["datatype"]);
+  have_byteorder = node["byteorder"].IsDefined();
+  if (have_byteorder)
+    yaml_decode(node["byteorder"], byteorder);
+  else
+    byteorder = host_byteorder();
+  if (node["shape"].IsDefined())
+    yaml_decode(node["shape"], shape);
 }
 
-field_t::field_t(const copy_state &cs, const field_t &field) { assert(0); }
+field_t::field_t(const copy_state &cs, const field_t &field)
+    : name(field.name), datatype(make_shared<datatype_t>(cs, *field.datatype)),
+      have_byteorder(field.have_byteorder), byteorder(field.byteorder),
+      shape(field.shape) {}
 
 YAML::Node field_t::to_yaml() const {
   YAML::Node node;
@@ -631,11 +766,20 @@ YAML::Node field_t::to_yaml() const {
   node["datatype"] = datatype->to_yaml();
   if (have_byteorder)
     node["byteorder"] = yaml_encode(byteorder);
-  if (!shape.empty())
+  if (!shape.empty()) {
     node["shape"] = shape;
+    node["shape"].SetStyle(YAML::EmitterStyle::Flow);
+  }
   return node;
 }
 
+size_t field_t::type_size() const {
+  size_t size = datatype->type_size();
+  for (const auto n : shape)
+    size *= n;
+  return size;
+}
+
 datatype_t::datatype_t(scalar_type_id_t scalar_type_id)
     : is_scalar(true), scalar_type_id(scalar_type_id) {}
 
@@ -647,10 +791,27 @@ size_t datatype_t::type_size() const {
     return get_scalar_type_size(scalar_type_id);
   size_t size = 0;
   for (const auto &field : fields)
-    size += field->datatype->type_size();
+    size += field->type_size();
   return size;
 }
 
+size_t datatype_t::get_field_index(const string &name) const {
+  assert(!is_scalar);
+  for (size_t i = 0; i < fields.size(); ++i)
+    if (fields[i]->name == name)
+      return i;
+  throw out_of_range("datatype: no field named \"" + name + "\"");
+}
+
+size_t datatype_t::get_field_offset(size_t index) const {
+  assert(!is_scalar);
+  assert(index < fields.size());
+  size_t offset = 0;
+  for (size_t i = 0; i < index; ++i)
+    offset += fields[i]->type_size();
+  return offset;
+}
+
 datatype_t::datatype_t(const shared_ptr<reader_state> &rs,
                        const YAML::Node &node) {
   if (node.IsScalar()) {
@@ -659,14 +820,23 @@ datatype_t::datatype_t(const shared_ptr<reader_state> &rs,
     return;
   }
   assert(node.IsSequence());
+  // String types are written as `[ascii, length]` or `[ucs4, length]`
+  if (node.size() == 2 && node[0].IsScalar() &&
+      (node[0].Scalar() == "ascii" || node[0].Scalar() == "ucs4"))
+    throw std::invalid_argument("String datatype `[" + node[0].Scalar() +
+                                ", " + node[1].Scalar() +
+                                "]` is not supported\n");
   is_scalar = false;
   fields.reserve(node.size());
   for (YAML::const_iterator ni = node.begin(); ni != node.end(); ++ni)
     fields.push_back(make_shared<field_t>(rs, *ni));
 }
 
-datatype_t::datatype_t(const copy_state &cs, const datatype_t &datatype) {
-  assert(0);
+datatype_t::datatype_t(const copy_state &cs, const datatype_t &datatype)
+    : is_scalar(datatype.is_scalar), scalar_type_id(datatype.scalar_type_id) {
+  fields.reserve(datatype.fields.size());
+  for (const auto &field : datatype.fields)
+    fields.push_back(make_shared<field_t>(cs, *field));
 }
 
 YAML::Node datatype_t::to_yaml() const {
@@ -678,16 +848,47 @@ YAML::Node datatype_t::to_yaml() const {
   return node;
 }
 
+namespace {
+// A field may itself be an array of elements
+void parse_field(const YAML::Node &node, unsigned char *&ptr,
+                 const field_t &field, byteorder_t byteorder, size_t dim = 0) {
+  if (dim == field.shape.size()) {
+    parse_scalar(node, ptr, field.datatype, byteorder);
+    ptr += field.datatype->type_size();
+    return;
+  }
+  assert(node.IsSequence() && int64_t(node.size()) == field.shape[dim]);
+  for (const auto &elt : node)
+    parse_field(elt, ptr, field, byteorder, dim + 1);
+}
+
+YAML::Node emit_field(const unsigned char *&ptr, const field_t &field,
+                      byteorder_t byteorder, size_t dim = 0) {
+  if (dim == field.shape.size()) {
+    YAML::Node node = emit_scalar(ptr, field.datatype, byteorder);
+    ptr += field.datatype->type_size();
+    return node;
+  }
+  YAML::Node node;
+  node.SetStyle(YAML::EmitterStyle::Flow);
+  for (int64_t i = 0; i < field.shape[dim]; ++i)
+    node.push_back(emit_field(ptr, field, byteorder, dim + 1));
+  return node;
+}
+} // namespace
+
 void parse_scalar(const YAML::Node &node, unsigned char *data,
                   const shared_ptr<datatype_t> &datatype,
                   byteorder_t byteorder) {
   if (datatype->is_scalar)
     return parse_scalar(node, data, datatype->scalar_type_id, byteorder);
+  // A record is a sequence of its fields
+  assert(node.IsSequence() && node.size() == datatype->fields.size());
   unsigned char *ptr = data;
-  for (const auto &field : datatype->fields) {
-    parse_scalar(node, ptr, field->datatype,
-                 field->have_byteorder ? field->byteorder : byteorder);
-    ptr += field->datatype->type_size();
+  for (size_t i = 0; i < datatype->fields.size(); ++i) {
+    const auto &field = *datatype->fields[i];
+    parse_field(node[i], ptr, field,
+                field.have_byteorder ? field.byteorder : byteorder);
   }
 }
 YAML::Node emit_scalar(const unsigned char *data,
@@ -698,12 +899,9 @@ YAML::Node emit_scalar(const unsigned char *data,
   YAML::Node node;
   node.SetStyle(YAML::EmitterStyle::Flow);
   const unsigned char *ptr = data;
-  for (const auto &field : datatype->fields) {
-    node.push_back(
-        emit_scalar(ptr, field->datatype,
-                    field->have_byteorder ? field->byteorder : byteorder));
-    ptr += field->datatype->type_size();
-  }
+  for (const auto &field : datatype->fields)
+    node.push_back(emit_field(
+        ptr, *field, field->have_byteorder ? field->byteorder : byteorder));
   return node;
 }
 
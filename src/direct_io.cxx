@@ -0,0 +1,261 @@
+#include <asdf/direct_io.hxx>
+
+#include <asdf/parallel.hxx>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <limits>
+#include <system_error>
+
+namespace ASDF {
+
+// Direct I/O
+
+namespace {
+streamoff align_down(streamoff pos, streamoff alignment) {
+  return pos / alignment * alignment;
+}
+streamoff align_up(streamoff pos, streamoff alignment) {
+  return align_down(pos + alignment - 1, alignment);
+}
+} // namespace
+
+size_t direct_io_alignment() {
+  static const size_t alignment =
+      max(size_t(4096), size_t(sysconf(_SC_PAGESIZE)));
+  return alignment;
+}
+
+void pwrite_all(int fd, const void *buf, size_t count, off_t offset) {
+  const char *ptr = static_cast<const char *>(buf);
+  while (count > 0) {
+    const ssize_t nbytes = ::pwrite(fd, ptr, count, offset);
+    if (nbytes < 0) {
+      if (errno == EINTR)
+        continue;
+      throw system_error(errno, generic_category(), "pwrite");
+    }
+    ptr += nbytes;
+    count -= nbytes;
+    offset += nbytes;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+direct_reader::direct_reader(int fd, const direct_io_options &options)
+    : fd(fd), options(options) {
+  assert(fd >= 0);
+}
+
+direct_reader::~direct_reader() {
+  if (prefetch.valid())
+    prefetch.wait();
+  ::close(fd);
+}
+
+shared_ptr<direct_reader>
+direct_reader::open(const string &filename, const direct_io_options &options) {
+#ifdef O_DIRECT
+  const int fd = ::open(filename.c_str(), O_RDONLY | O_DIRECT);
+  if (fd < 0)
+    return nullptr;
+  return shared_ptr<direct_reader>(new direct_reader(fd, options));
+#else
+  return nullptr;
+#endif
+}
+
+void direct_reader::set_ranges(vector<pair<streamoff, size_t>> ranges1) {
+  sort(ranges1.begin(), ranges1.end());
+  lock_guard<mutex> lock(mtx);
+  ranges = std::move(ranges1);
+}
+
+shared_ptr<block_t> direct_reader::read_direct(streamoff pos,
+                                               size_t count) const {
+  const streamoff alignment = direct_io_alignment();
+  const streamoff begin = align_down(pos, alignment);
+  const streamoff end = align_up(pos + streamoff(count), alignment);
+  auto block =
+      make_shared<aligned_block_t>(alignment, end - begin, pos - begin, count);
+  unsigned char *const buf = block->storage_ptr();
+
+  // Read in chunks, with several requests in flight
+  const streamoff chunk_size =
+      align_up(max(streamoff(options.chunk_size), alignment), alignment);
+  const int64_t nchunks = (end - begin + chunk_size - 1) / chunk_size;
+  parallel_for(nchunks, options.queue_depth, [&](int64_t n) {
+    const streamoff chunk_begin = begin + n * chunk_size;
+    const streamoff chunk_end = min(end, chunk_begin + chunk_size);
+    // The file might end before the aligned end of the chunk
+    const streamoff need_end = min(chunk_end, pos + streamoff(count));
+    streamoff done = chunk_begin;
+    while (done < need_end) {
+      const ssize_t nbytes =
+          ::pread(fd, buf + (done - begin), chunk_end - done, done);
+      if (nbytes < 0) {
+        if (errno == EINTR)
+          continue;
+        throw system_error(errno, generic_category(), "pread");
+      }
+      assert(nbytes > 0);
+      done += nbytes;
+      // A short read happens only at the end of the file
+      if (nbytes % alignment != 0)
+        break;
+    }
+    assert(done >= need_end);
+  });
+
+  return block;
+}
+
+shared_ptr<block_t> direct_reader::read(streamoff pos, size_t count) {
+  future<shared_ptr<block_t>> result;
+  {
+    lock_guard<mutex> lock(mtx);
+    if (prefetch.valid() && prefetch_range == make_pair(pos, count))
+      result = std::move(prefetch);
+    if (options.readahead) {
+      // Read the following block in the background
+      const auto next =
+          upper_bound(ranges.begin(), ranges.end(),
+                      make_pair(pos, numeric_limits<size_t>::max()));
+      if (next != ranges.end() &&
+          !(prefetch.valid() && prefetch_range == *next)) {
+        // This waits for a stale prefetch to finish
+        prefetch_range = *next;
+        prefetch = async(launch::async, [this, range = *next]() {
+          return read_direct(range.first, range.second);
+        });
+      }
+    }
+  }
+  if (result.valid())
+    return result.get();
+  return read_direct(pos, count);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+direct_streambuf::direct_streambuf(const string &filename, streamoff pos,
+                                   const direct_io_options &options)
+    : options(options) {
+  buffered_fd = ::open(filename.c_str(), O_WRONLY);
+  if (buffered_fd < 0)
+    throw system_error(errno, generic_category(), filename);
+#ifdef O_DIRECT
+  // Fall back to the page cache if direct I/O is not supported
+  fd = ::open(filename.c_str(), O_WRONLY | O_DIRECT);
+#else
+  fd = -1;
+#endif
+
+  const streamoff alignment = direct_io_alignment();
+  const streamoff chunk_size =
+      align_up(max(streamoff(options.chunk_size), alignment), alignment);
+  chunks.resize(max(1, options.queue_depth));
+  for (auto &chunk : chunks)
+    chunk.buffer =
+        make_shared<aligned_block_t>(alignment, chunk_size, 0, chunk_size);
+  current = 0;
+  chunk_pos = align_down(pos, alignment);
+  valid_begin = pos;
+  unsigned char *const buf = chunks.at(current).buffer->storage_ptr();
+  setp(reinterpret_cast<char *>(buf),
+       reinterpret_cast<char *>(buf + chunk_size));
+  pbump(pos - chunk_pos);
+}
+
+direct_streambuf::~direct_streambuf() {
+  for (auto &chunk : chunks)
+    if (chunk.written.valid())
+      chunk.written.wait();
+  if (fd >= 0)
+    ::close(fd);
+  if (buffered_fd >= 0)
+    ::close(buffered_fd);
+}
+
+void direct_streambuf::write_range(const unsigned char *buf, streamoff buf_pos,
+                                   streamoff begin, streamoff end) const {
+  const streamoff alignment = direct_io_alignment();
+  const streamoff mid_begin = min(end, align_up(begin, alignment));
+  const streamoff mid_end = max(mid_begin, align_down(end, alignment));
+  const auto write = [&](int wfd, streamoff first, streamoff last) {
+    pwrite_all(wfd, buf + (first - buf_pos), last - first, first);
+  };
+  if (begin < mid_begin)
+    write(buffered_fd, begin, mid_begin);
+  if (mid_begin < mid_end)
+    write(fd >= 0 ? fd : buffered_fd, mid_begin, mid_end);
+  if (mid_end < end)
+    write(buffered_fd, mid_end, end);
+}
+
+void direct_streambuf::submit() {
+  // Write the current chunk in the background
+  chunk_t &chunk = chunks.at(current);
+  const streamoff end = chunk_pos + (pptr() - pbase());
+  chunk.written =
+      async(launch::async, [this, buffer = chunk.buffer, buf_pos = chunk_pos,
+                            begin = valid_begin, end]() {
+        write_range(buffer->storage_ptr(), buf_pos, begin, end);
+      });
+
+  // Continue with the next chunk, waiting until it has been written
+  current = (current + 1) % chunks.size();
+  chunk_t &next = chunks.at(current);
+  if (next.written.valid())
+    next.written.get();
+  chunk_pos = end;
+  valid_begin = end;
+  unsigned char *const buf = next.buffer->storage_ptr();
+  setp(reinterpret_cast<char *>(buf),
+       reinterpret_cast<char *>(buf + next.buffer->storage_size()));
+}
+
+direct_streambuf::int_type direct_streambuf::overflow(int_type ch) {
+  assert(buffered_fd >= 0);
+  submit();
+  if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+  }
+  return traits_type::not_eof(ch);
+}
+
+direct_streambuf::pos_type
+direct_streambuf::seekoff(off_type off, ios_base::seekdir dir,
+                          ios_base::openmode which) {
+  // Only support querying the current position
+  if (off != 0 || dir != ios_base::cur || !(which & ios_base::out))
+    return pos_type(off_type(-1));
+  return pos_type(chunk_pos + (pptr() - pbase()));
+}
+
+streamoff direct_streambuf::close() {
+  assert(buffered_fd >= 0);
+  const streamoff end = chunk_pos + (pptr() - pbase());
+  write_range(chunks.at(current).buffer->storage_ptr(), chunk_pos, valid_begin,
+              end);
+  for (auto &chunk : chunks)
+    if (chunk.written.valid())
+      chunk.written.get();
+  setp(nullptr, nullptr);
+  if (fd >= 0)
+    ::close(fd);
+  fd = -1;
+  const int ierr = ::close(buffered_fd);
+  buffered_fd = -1;
+  if (ierr != 0)
+    throw system_error(errno, generic_category(), "close");
+  return end;
+}
+
+} // namespace ASDF
@@ -6,19 +6,10 @@
 #include <cstdlib>
 #include <optional>
 #include <sstream>
+#include <stdexcept>
 
 namespace ASDF {
 
-namespace {
-template <typename T> std::optional<T> try_parse_yaml(const YAML::Node &node) {
-  try {
-    return node.as<T>();
-  } catch (const YAML::BadConversion &e) {
-    return std::optional<T>();
-  }
-}
-} // namespace
-
 ////////////////////////////////////////////////////////////////////////////////
 
 std::ostream &operator<<(std::ostream &os, entry_type_t entry_type) {
@@ -41,6 +32,10 @@ std::ostream &operator<<(std::ostream &os, entry_type_t entry_type) {
     return os << "history_entry";
   case entry_type_t::ndarray:
     return os << "ndarray";
+  case entry_type_t::tiled_ndarray:
+    return os << "tiled_ndarray";
+  case entry_type_t::table:
+    return os << "table";
   case entry_type_t::reference:
     return os << "reference";
   case entry_type_t::sequence:
@@ -104,6 +99,23 @@ ndarray_entry::ndarray_entry(const copy_state &cs, const ndarray_entry &arr)
 
 writer &ndarray_entry::to_yaml(writer &w) const { return w << *value; }
 
+tiled_ndarray_entry::tiled_ndarray_entry(
+    const std::shared_ptr<reader_state> &rs, const YAML::Node node)
+    : value(std::make_shared<tiled_ndarray>(rs, node)) {}
+tiled_ndarray_entry::tiled_ndarray_entry(const copy_state &cs,
+                                         const tiled_ndarray_entry &arr)
+    : value(std::make_shared<tiled_ndarray>(cs, *arr.value)) {}
+
+writer &tiled_ndarray_entry::to_yaml(writer &w) const { return w << *value; }
+
+table_entry::table_entry(const std::shared_ptr<reader_state> &rs,
+                         const YAML::Node node)
+    : value(std::make_shared<table>(rs, node)) {}
+table_entry::table_entry(const copy_state &cs, const table_entry &tab)
+    : value(std::make_shared<table>(cs, *tab.value)) {}
+
+writer &table_entry::to_yaml(writer &w) const { return w << *value; }
+
 reference_entry::reference_entry(const std::shared_ptr<reader_state> &rs,
                                  const YAML::Node node)
     : value(std::make_shared<reference>(rs, node)) {}
@@ -116,18 +128,83 @@ writer &reference_entry::to_yaml(writer &w) const { return w << *value; }
 sequence::sequence(const shared_ptr<reader_state> &rs, const YAML::Node &node)
     : sequence() {
   assert(node.IsSequence());
-  for (const auto &value : node)
-    push_back(make_entry(rs, value));
+  entries->resize(node.size());
+  lazy = make_shared<lazy_node_t>(rs, node);
 }
 
 sequence::sequence(const copy_state &cs, const sequence &from) : sequence() {
-  for (const auto &value : *from.entries)
+  for (const auto &value : *from.get_sequence())
     push_back(value->copy(cs));
 }
 
+void sequence::materialize() const {
+  if (!lazy)
+    return;
+  lock_guard<mutex> lock(lazy->mtx);
+  if (lazy->complete)
+    return;
+  const YAML::Node &node = lazy->node;
+  for (size_t n = 0; n < entries->size(); ++n)
+    if (!(*entries)[n])
+      (*entries)[n] = make_entry(lazy->rs, node[n]);
+  lazy->node.reset();
+  lazy->rs.reset();
+  lazy->complete = true;
+}
+
+shared_ptr<entry> sequence::at(const size_t n) const {
+  if (!lazy)
+    return entries->at(n);
+  lock_guard<mutex> lock(lazy->mtx);
+  auto &value = entries->at(n);
+  if (!value) {
+    const YAML::Node &node = lazy->node;
+    value = make_entry(lazy->rs, node[n]);
+  }
+  return value;
+}
+
+namespace {
+// Convert a sequence of integers or reals to an array, or return null if
+// the sequence contains other entries
+shared_ptr<ndarray>
+make_numeric_array(const vector<shared_ptr<entry>> &entries) {
+  bool all_int = true;
+  for (const auto &value : entries) {
+    const auto type = value->get_entry_type();
+    if (type == entry_type_t::float64)
+      all_int = false;
+    else if (type != entry_type_t::int64)
+      return nullptr;
+  }
+  const vector<int64_t> shape{int64_t(entries.size())};
+  if (all_int) {
+    vector<int64_t> data;
+    data.reserve(entries.size());
+    for (const auto &value : entries)
+      data.push_back(*value->get_maybe_int());
+    return make_shared<ndarray>(std::move(data), block_format_t::block,
+                                compression_t::none, 0, vector<bool>(), shape);
+  }
+  vector<float64_t> data;
+  data.reserve(entries.size());
+  for (const auto &value : entries) {
+    const auto int64 = value->get_maybe_int();
+    data.push_back(int64 ? float64_t(*int64) : *value->get_maybe_float());
+  }
+  return make_shared<ndarray>(std::move(data), block_format_t::block,
+                              compression_t::none, 0, vector<bool>(), shape);
+}
+} // namespace
+
 writer &sequence::to_yaml(writer &w) const {
+  const auto &entries = *get_sequence();
+  const int64_t threshold = w.get_options().inline_threshold;
+  if (threshold >= 0 && int64_t(entries.size()) > threshold)
+    if (const auto arr = make_numeric_array(entries))
+      return w << *arr;
   w << YAML::BeginSeq;
-  for (const auto &value : *entries)
+  for (const auto &value : entries)
     w << *value;
   w << YAML::EndSeq;
   return w;
@@ -136,18 +213,73 @@ writer &sequence::to_yaml(writer &w) const {
 group::group(const shared_ptr<reader_state> &rs, const YAML::Node &node)
     : group() {
   assert(node.IsMap());
-  for (const auto &key_value : node)
-    insert({key_value.first.Scalar(), make_entry(rs, key_value.second)});
+  lazy = make_shared<lazy_node_t>(rs, node);
 }
 
 group::group(const copy_state &cs, const group &from) : group() {
-  for (const auto &[key, value] : *from.entries)
+  for (const auto &[key, value] : *from.get_group())
     insert({key, value->copy(cs)});
 }
 
+void group::materialize() const {
+  if (!lazy)
+    return;
+  lock_guard<mutex> lock(lazy->mtx);
+  if (lazy->complete)
+    return;
+  for (const auto &key_value : lazy->node) {
+    const auto &key = key_value.first.Scalar();
+    if (!entries->count(key))
+      entries->emplace(key, make_entry(lazy->rs, key_value.second));
+  }
+  lazy->node.reset();
+  lazy->rs.reset();
+  lazy->complete = true;
+}
+
+shared_ptr<entry> group::find(const string &key) const {
+  if (lazy) {
+    lock_guard<mutex> lock(lazy->mtx);
+    if (!lazy->complete) {
+      const auto iter = entries->find(key);
+      if (iter != entries->end())
+        return iter->second;
+      const YAML::Node &node = lazy->node;
+      const YAML::Node value = node[key];
+      if (!value)
+        return nullptr;
+      auto ent = make_entry(lazy->rs, value);
+      entries->emplace(key, ent);
+      return ent;
+    }
+  }
+  const auto iter = entries->find(key);
+  return iter == entries->end() ? nullptr : iter->second;
+}
+
+size_t group::count(const string &key) const {
+  if (lazy) {
+    lock_guard<mutex> lock(lazy->mtx);
+    if (!lazy->complete) {
+      if (entries->count(key))
+        return 1;
+      const YAML::Node &node = lazy->node;
+      return bool(node[key]);
+    }
+  }
+  return entries->count(key);
+}
+
+shared_ptr<entry> group::at(const string &key) const {
+  auto value = find(key);
+  if (!value)
+    throw out_of_range("group::at: key \"" + key + "\" not found");
+  return value;
+}
+
 writer &group::to_yaml(writer &w) const {
   w << YAML::BeginMap;
-  for (const auto &[key, value] : *entries)
+  for (const auto &[key, value] : *get_group())
     w << YAML::Key << key << YAML::Value << *value;
   w << YAML::EndMap;
   return w;
@@ -175,30 +307,33 @@ std::shared_ptr<entry> make_entry(const std::shared_ptr<reader_state> &rs,
   if (tag == "tag:stsci.edu:asdf/core/ndarray-1.0.0")
     return std::make_shared<ndarray_entry>(std::make_shared<ndarray>(rs, node));
 
+  if (tag == tiled_ndarray::tag)
+    return std::make_shared<tiled_ndarray_entry>(rs, node);
+
+  if (tag == "tag:stsci.edu:asdf/core/table-1.0.0")
+    return std::make_shared<table_entry>(rs, node);
+
   assert(tag.empty() || tag == "?" || tag == "!");
 
   // Next look at the node type.
   if (node.IsNull())
     return std::make_shared<null_entry>(std::tuple<>());
 
-  // Scalar nodes can be either boo, int, float, or string. Try in this order.
-  if (node.IsScalar()) {
-    const auto bool8 = try_parse_yaml<bool>(node);
-    if (bool8)
-      return std::make_shared<bool_entry>(*bool8);
-  }
+  // Scalar nodes can be either bool, int, float, or string. Try in this
+  // order. Quoted scalars are always strings.
   if (node.IsScalar()) {
-    const auto int64 = try_parse_yaml<int64_t>(node);
-    if (int64)
-      return std::make_shared<int_entry>(*int64);
+    const auto scalar = classify_yaml_scalar(node);
+    switch (scalar.type) {
+    case entry_type_t::bool8:
+      return std::make_shared<bool_entry>(scalar.bool_value);
+    case entry_type_t::int64:
+      return std::make_shared<int_entry>(scalar.int_value);
+    case entry_type_t::float64:
+      return std::make_shared<float_entry>(scalar.float_value);
+    default:
+      return std::make_shared<string_entry>(node.Scalar());
+    }
   }
-  if (node.IsScalar()) {
-    const auto float64 = try_parse_yaml<float64_t>(node);
-    if (float64)
-      return std::make_shared<float_entry>(*float64);
-  }
-  if (node.IsScalar())
-    return std::make_shared<string_entry>(node.Scalar());
 
   // Sequences are straightforward.
   if (node.IsSequence())
@@ -216,4 +351,29 @@ std::shared_ptr<entry> make_entry(const std::shared_ptr<reader_state> &rs,
   std::abort();
 }
 
+yaml_scalar_t classify_yaml_scalar(const YAML::Node &node) {
+  assert(node.IsScalar());
+  const std::string &str = node.Scalar();
+  yaml_scalar_t scalar;
+  if (node.Tag() != "!") {
+    if (const auto bool8 = parse_yaml_bool(str)) {
+      scalar.type = entry_type_t::bool8;
+      scalar.bool_value = *bool8;
+      return scalar;
+    }
+    if (const auto int64 = parse_yaml_int(str)) {
+      scalar.type = entry_type_t::int64;
+      scalar.int_value = *int64;
+      return scalar;
+    }
+    if (const auto float64 = parse_yaml_float(str)) {
+      scalar.type = entry_type_t::float64;
+      scalar.float_value = *float64;
+      return scalar;
+    }
+  }
+  scalar.type = entry_type_t::string;
+  return scalar;
+}
+
 } // namespace ASDF
@@ -0,0 +1,133 @@
+#include <asdf/file_cache.hxx>
+
+#include <asdf/asdf.hxx>
+
+#include <sys/resource.h>
+
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace ASDF {
+
+// File cache
+
+file_cache::file_cache() : max_open_files(0) {
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0 &&
+      limit.rlim_cur != RLIM_INFINITY)
+    max_open_files = max(rlim_t(1), limit.rlim_cur / 2);
+}
+
+file_cache &file_cache::global() {
+  // The cache is never destroyed, so that streams can still unregister
+  // themselves while the program exits
+  static file_cache *const cache = new file_cache;
+  return *cache;
+}
+
+shared_ptr<reader_state> file_cache::open(const string &filename,
+                                          const reader_options &options) {
+  const string path = filesystem::weakly_canonical(filename).string();
+  const auto file_id = file_id_t::get(path);
+  assert(file_id);
+  {
+    lock_guard<mutex> lock(mtx);
+    const auto [begin, end] = files.equal_range(path);
+    for (auto iter = begin; iter != end; ++iter) {
+      const auto &file = iter->second;
+      if (file.file_id == *file_id && file.options == options)
+        if (auto rs = file.rs.lock())
+          return rs;
+    }
+  }
+
+  // Open the file without holding the lock, so that several files can be
+  // opened concurrently
+  const auto pis = make_shared<ifstream>(path, ios::binary | ios::in);
+  assert(*pis);
+  const auto doc = asdf::from_yaml(*pis);
+  const auto rs = make_shared<reader_state>(doc, pis, path, options);
+
+  lock_guard<mutex> lock(mtx);
+  // Remove files that are not in use any more, or that have been modified
+  for (auto iter = files.begin(); iter != files.end();) {
+    const auto &file = iter->second;
+    if (file.rs.expired() || (iter->first == path && file.file_id != *file_id))
+      iter = files.erase(iter);
+    else
+      ++iter;
+  }
+  // Another thread might have opened the same file in the meantime
+  const auto [begin, end] = files.equal_range(path);
+  for (auto iter = begin; iter != end; ++iter) {
+    const auto &file = iter->second;
+    if (file.file_id == *file_id && file.options == options)
+      if (auto other = file.rs.lock())
+        return other;
+  }
+  files.emplace(path, file_t{rs, *file_id, options});
+  return rs;
+}
+
+void file_cache::clear() {
+  lock_guard<mutex> lock(mtx);
+  files.clear();
+}
+
+size_t file_cache::get_max_open_files() const {
+  lock_guard<mutex> lock(mtx);
+  return max_open_files;
+}
+
+void file_cache::set_max_open_files(size_t max_open_files1) {
+  lock_guard<mutex> lock(mtx);
+  max_open_files = max_open_files1;
+}
+
+size_t file_cache::get_num_open_files() const {
+  lock_guard<mutex> lock(mtx);
+  return open_streams.size();
+}
+
+void file_cache::touch(const shared_ptr<shared_istream> &psis) {
+  if (!psis->can_reopen())
+    return;
+  vector<shared_ptr<shared_istream>> victims;
+  {
+    lock_guard<mutex> lock(mtx);
+    const auto pos = open_stream_positions.find(psis.get());
+    if (pos != open_stream_positions.end()) {
+      open_streams.splice(open_streams.begin(), open_streams, pos->second);
+    } else {
+      open_streams.emplace_front(psis.get(), psis);
+      open_stream_positions.emplace(psis.get(), open_streams.begin());
+    }
+    // Evict the least recently used streams
+    while (max_open_files > 0 && open_streams.size() > max_open_files) {
+      const auto &[ptr, weak] = open_streams.back();
+      assert(ptr != psis.get());
+      if (auto victim = weak.lock())
+        victims.push_back(std::move(victim));
+      open_stream_positions.erase(ptr);
+      open_streams.pop_back();
+    }
+  }
+  // Close the evicted streams only after releasing the lock, since closing
+  // waits for ongoing reads, and since streams unregister themselves when
+  // they are destroyed
+  for (const auto &victim : victims)
+    victim->close();
+}
+
+void file_cache::forget(const shared_istream *psis) {
+  lock_guard<mutex> lock(mtx);
+  const auto pos = open_stream_positions.find(psis);
+  if (pos == open_stream_positions.end())
+    return;
+  open_streams.erase(pos->second);
+  open_stream_positions.erase(pos);
+}
+
+} // namespace ASDF
@@ -1,12 +1,32 @@
 #include <asdf/io.hxx>
 
 #include <asdf/asdf.hxx>
+#include <asdf/batch_io.hxx>
+#include <asdf/direct_io.hxx>
+#include <asdf/file_cache.hxx>
 #include <asdf/ndarray.hxx>
+#include <asdf/parallel.hxx>
 
 #include <yaml-cpp/yaml.h>
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
+#include <condition_variable>
 #include <cstdlib>
+#include <deque>
+#include <exception>
+#include <filesystem>
 #include <fstream>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <system_error>
+#include <thread>
 
 namespace ASDF {
 
@@ -27,6 +47,22 @@ bool have_float16() {
 #endif
 }
 
+bool have_direct_io() {
+#ifdef O_DIRECT
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool have_liburing() {
+#ifdef ASDF_HAVE_LIBURING
+  return true;
+#else
+  return false;
+#endif
+}
+
 bool have_checksum() {
 #ifdef ASDF_HAVE_OPENSSL
   return true;
@@ -111,16 +147,115 @@ std::ostream &operator<<(std::ostream &os, compression_t compression) {
   }
 }
 
+optional<file_id_t> file_id_t::get(const string &filename) {
+  struct stat buf;
+  if (stat(filename.c_str(), &buf) != 0)
+    return {};
+  error_code ec;
+  const auto mtime = filesystem::last_write_time(filename, ec);
+  if (ec)
+    return {};
+  return file_id_t{uint64_t(buf.st_dev), uint64_t(buf.st_ino),
+                   uint64_t(buf.st_size),
+                   int64_t(mtime.time_since_epoch().count())};
+}
+
+shared_istream::shared_istream(shared_ptr<istream> pis1,
+                               shared_ptr<direct_reader> direct1,
+                               const string &filename1)
+    : pis(std::move(pis1)), direct(std::move(direct1)) {
+  assert(pis);
+  // Only file streams can be reopened by name
+  if (dynamic_cast<ifstream *>(pis.get()) && !filename1.empty()) {
+    filename = filesystem::weakly_canonical(filename1).string();
+    file_id = file_id_t::get(filename);
+  }
+}
+
+shared_istream::~shared_istream() {
+  if (!filename.empty())
+    file_cache::global().forget(this);
+}
+
+void shared_istream::reopen() {
+  if (pis)
+    return;
+  assert(!filename.empty());
+  // The file must not have been replaced or modified while it was closed
+  assert(file_id_t::get(filename) == file_id);
+  pis = make_shared<ifstream>(filename, ios::binary | ios::in);
+  assert(*pis);
+}
+
+istream &shared_istream::get_istream() {
+  // The stream is not registered with the file cache here, so that it is
+  // not closed while it is being scanned
+  lock_guard<mutex> lock(mtx);
+  reopen();
+  return *pis;
+}
+
+shared_ptr<block_t> shared_istream::read(streamoff pos, size_t count) {
+  if (direct)
+    return direct->read(pos, count);
+  vector<unsigned char> data(count);
+  {
+    lock_guard<mutex> lock(mtx);
+    reopen();
+    istream &is = *pis;
+    assert(is);
+    is.seekg(pos);
+    assert(is);
+    is.read(reinterpret_cast<char *>(data.data()), data.size());
+    assert(is);
+  }
+  // Touch the stream only after releasing the lock, since this might close
+  // other streams
+  file_cache::global().touch(shared_from_this());
+  return make_shared<typed_block_t<unsigned char>>(std::move(data));
+}
+
+void shared_istream::close() {
+  if (filename.empty())
+    return;
+  lock_guard<mutex> lock(mtx);
+  pis.reset();
+}
+
 reader_state::reader_state(const YAML::Node &tree,
                            const shared_ptr<istream> &pis,
-                           const string &filename)
-    : tree(tree), filename(filename) {
+                           const string &filename,
+                           const reader_options &options)
+    : tree(tree), filename(filename), options(options),
+      reference_cache(make_unique<reference_cache_t>()),
+      external_files(make_unique<external_files_t>()) {
+  shared_ptr<direct_reader> direct;
+  if (options.direct_io.enable && !filename.empty())
+    direct = direct_reader::open(filename, options.direct_io);
+  psis = make_shared<shared_istream>(pis, direct, filename);
+  vector<pair<streamoff, size_t>> ranges;
   for (;;) {
-    const auto [block, block_info] = ndarray::read_block(pis);
+    const streamoff block_pos = pis->tellg();
+    const auto [block, block_info] = ndarray::read_block(psis);
     if (!block.valid())
       break;
+    const streamoff data_pos =
+        block_pos + ndarray::block_header_prefix_size + block_info.header_size;
+    ranges.emplace_back(data_pos, block_info.used_space);
     blocks.push_back(std::move(block));
     block_infos.push_back(std::move(block_info));
+    block_data_positions.push_back(data_pos);
+  }
+  if (direct)
+    direct->set_ranges(std::move(ranges));
+  // The stream may be closed from now on if too many files are open
+  file_cache::global().touch(psis);
+
+  if (options.preload_blocks) {
+    vector<int64_t> indices(blocks.size());
+    for (size_t n = 0; n < indices.size(); ++n)
+      indices.at(n) = n;
+    read_blocks(indices, options.batch_read);
   }
 }
 
@@ -129,73 +264,152 @@ block_info_t reader_state::get_block_info(int64_t index) const {
   return block_infos.at(index);
 }
 
+void reader_state::read_blocks(const vector<int64_t> &indices,
+                               const batch_read_options &options) const {
+  vector<int64_t> todo;
+  for (const int64_t index : indices)
+    if (!blocks.at(index).ready())
+      todo.push_back(index);
+  if (todo.empty())
+    return;
+
+  vector<read_request_t> requests;
+  for (const int64_t index : todo)
+    requests.push_back({block_data_positions.at(index),
+                        block_infos.at(index).used_space});
+  const auto decode = [&](size_t n, const shared_ptr<block_t> &data) {
+    const int64_t index = todo.at(n);
+    blocks.at(index).set(ndarray::decode_block(data, block_infos.at(index)));
+  };
+
+  // Read via the shared stream if there is no file name, or if direct I/O
+  // is used
+  const int fd = filename.empty() || this->options.direct_io.enable
+                     ? -1
+                     : ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    parallel_for(todo.size(), options.nthreads, [&](int64_t n) {
+      decode(n, psis->read(requests.at(n).pos, requests.at(n).count));
+    });
+    return;
+  }
+  try {
+    batch_read(fd, requests, options, decode);
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+}
+
 YAML::Node reader_state::resolve_reference(const vector<string> &path) const {
-  // We allocate a new YAML node each time we take a step. If we don't
-  // do this, yaml-cpp will instead only create a reference (alias) to
-  // the new node, thus effectively overwriting the "tree" field.
-  auto node = unique_ptr<YAML::Node>(new YAML::Node(tree));
-  assert(node->IsDefined());
+  lock_guard<mutex> lock(reference_cache->mtx);
+  auto &nodes = reference_cache->nodes;
+  const auto iter = nodes.find(path);
+  if (iter != nodes.end())
+    return iter->second;
+
+  // Walk the path, starting from the longest prefix that has already been
+  // resolved. Note that assigning to a YAML node would overwrite the node it
+  // refers to (e.g. "tree"); we use "reset" to rebind it instead.
+  YAML::Node node(tree);
+  assert(node.IsDefined());
+  vector<string> prefix;
+  prefix.reserve(path.size());
   for (const auto &elem : path) {
-    if (node->IsSequence()) {
-      int idx = [=]() {
-        try {
-          return stoi(elem);
-        } catch (exception &) {
-          assert(0);
-          std::abort();
-        }
-      }();
-      node = unique_ptr<YAML::Node>(new YAML::Node((*node)[idx]));
-    } else if (node->IsMap()) {
-      node = unique_ptr<YAML::Node>(new YAML::Node((*node)[elem]));
+    prefix.push_back(elem);
+    const auto cached = nodes.find(prefix);
+    if (cached != nodes.end()) {
+      node.reset(cached->second);
+      continue;
+    }
+    const YAML::Node &parent = node;
+    if (parent.IsSequence()) {
+      size_t idx;
+      const auto res =
+          from_chars(elem.data(), elem.data() + elem.size(), idx, 10);
+      assert(res.ec == errc() && res.ptr == elem.data() + elem.size());
+      assert(idx < parent.size());
+      node.reset(parent[idx]);
+    } else if (parent.IsMap()) {
+      node.reset(parent[elem]);
     } else {
       // Could not resolve reference
       // TODO: Output an actual error message
       assert(0);
     }
-    assert(node->IsDefined());
+    assert(node.IsDefined());
+    nodes.emplace(prefix, node);
   }
-  return *node;
+  return node;
+}
+
+shared_ptr<reader_state>
+reader_state::get_external_file(const string &filename) const {
+  assert(!filename.empty());
+  {
+    lock_guard<mutex> lock(external_files->mtx);
+    const auto iter = external_files->files.find(filename);
+    if (iter != external_files->files.end())
+      return iter->second;
+  }
+  string ext_filename;
+  if (filename[0] == '/') {
+    // absolute path
+    ext_filename = filename;
+  } else {
+    // preprend current path
+    assert(!this->filename.empty()); // We could allow this
+    auto slashpos = this->filename.rfind('/');
+    if (slashpos == string::npos)
+      ext_filename = filename;
+    else
+      ext_filename = this->filename.substr(0, slashpos + 1) + filename;
+  }
+  // Open the file without holding the lock, so that several files can be
+  // opened concurrently
+  auto ext = file_cache::global().open(ext_filename, options);
+  lock_guard<mutex> lock(external_files->mtx);
+  return external_files->files.emplace(filename, std::move(ext)).first->second;
 }
 
 pair<shared_ptr<reader_state>, YAML::Node>
 reader_state::resolve_reference(const shared_ptr<reader_state> &rs,
                                 const string &filename,
                                 const vector<string> &path) {
-  shared_ptr<reader_state> refrs;
-  if (filename.empty()) {
-    // Read from same file
-    refrs = rs;
-  } else {
-    // Read from external file
-    string ref_filename;
-    if (!filename.empty() && filename[0] == '/') {
-      // absolute path
-      ref_filename = filename;
-    } else {
-      // preprend current path
-      assert(!rs->filename.empty()); // We could allow this
-      auto slashpos = rs->filename.rfind('/');
-      if (slashpos == string::npos)
-        ref_filename = filename;
-      else
-        ref_filename = rs->filename.substr(0, slashpos + 1) + filename;
-    }
-    if (!rs->other_files.count(ref_filename)) {
-      auto pis = make_shared<ifstream>(ref_filename, ios::binary | ios::in);
-      auto doc = asdf::from_yaml((istream &)*pis);
-      rs->other_files[ref_filename] =
-          make_shared<reader_state>(doc, pis, ref_filename);
-    }
-    refrs = rs->other_files.at(ref_filename);
-  }
-
+  // Read from same file, or from external file
+  auto refrs = filename.empty() ? rs : rs->get_external_file(filename);
   auto node = refrs->resolve_reference(path);
   return make_pair(refrs, node);
 }
 
-writer::writer(ostream &os, const map<string, string> &tags)
-    : os(os), emitter(os) {
+writer::writer(ostream &os, const map<string, string> &tags,
+               const writer_options &options)
+    : os(os), emitter(os), options(options) {
+  write_prologue(tags);
+}
+
+namespace {
+unique_ptr<ostream> open_output(const string &filename,
+                                const writer_options &options) {
+  // When writing collectively, only process 0 writes the tree; the other
+  // processes discard it
+  if (options.coordinator && options.coordinator->rank() != 0)
+    return make_unique<ostringstream>();
+  return make_unique<ofstream>(filename, ios::binary | ios::trunc | ios::out);
+}
+} // namespace
+
+writer::writer(const string &filename, const map<string, string> &tags,
+               const writer_options &options)
+    : owned_os(open_output(filename, options)), os(*owned_os),
+      filename(filename), emitter(os), options(options) {
+  assert(os);
+  assert(!options.coordinator || options.explode_threshold < 0);
+  write_prologue(tags);
+}
+
+void writer::write_prologue(const map<string, string> &tags) {
   // yaml-cpp does not support comments without leading space
   os << "#ASDF " << asdf_format_version << "\n"
      << "#ASDF_STANDARD " << asdf_standard_version() << "\n"
@@ -208,18 +422,132 @@ writer::writer(ostream &os, const map<string, string> &tags)
   emitter << YAML::BeginDoc;
 }
 
-writer::~writer() { assert(tasks.empty()); }
+writer::~writer() {
+  assert(blocks.empty());
+  assert(external_blocks.empty());
+}
+
+string writer::add_external_block(function<prepared_block_t()> &&prepare) {
+  assert(!filename.empty());
+  // Name the exploded files after the main file, e.g. "data0000.asdf",
+  // "data0001.asdf" etc. for "data.asdf"
+  const string suffix = ".asdf";
+  string base = filename;
+  if (base.size() > suffix.size() &&
+      base.compare(base.size() - suffix.size(), suffix.size(), suffix) == 0)
+    base.erase(base.size() - suffix.size());
+  ostringstream buf;
+  buf << base << setw(4) << setfill('0') << external_blocks.size() << suffix;
+  const string ext_filename = buf.str();
+  external_blocks.emplace_back(ext_filename, std::move(prepare));
+  const auto slashpos = ext_filename.rfind('/');
+  return slashpos == string::npos ? ext_filename
+                                  : ext_filename.substr(slashpos + 1);
+}
+
+void writer::write_external_blocks() {
+  // Each exploded file holds a single block, and a tree without entries
+  writer_options ext_options = options;
+  ext_options.nthreads = 1;
+  ext_options.explode_threshold = -1;
+  parallel_for(external_blocks.size(), options.nthreads, [&](int64_t n) {
+    auto &[ext_filename, prepare] = external_blocks.at(n);
+    writer w(ext_filename, {}, ext_options);
+    w << YAML::LocalTag("core/asdf-1.1.0") << YAML::BeginMap;
+    w << YAML::Key << "asdf/library" << YAML::Value
+      << software(ASDF_CXX_NAME, ASDF_CXX_AUTHOR, ASDF_CXX_HOMEPAGE,
+                  ASDF_CXX_VERSION);
+    w << YAML::EndMap;
+    w.add_block(std::move(prepare));
+    w.flush();
+  });
+  external_blocks.clear();
+}
+
+namespace {
+uint64_t align_up(uint64_t pos, uint64_t alignment) {
+  return (pos + alignment - 1) / alignment * alignment;
+}
+
+constexpr uint64_t block_header_prefix_size = ndarray::block_header_prefix_size;
+constexpr uint64_t min_block_header_size = ndarray::block_header_fields_size;
+} // namespace
+
+void writer::pad_tree() {
+  // The block header alone can absorb the padding for small alignments
+  const uint64_t alignment = options.block_alignment;
+  if (alignment <= 1 ||
+      alignment - 1 <= numeric_limits<uint16_t>::max() - min_block_header_size)
+    return;
+  // Add a comment to the end of the tree so that the first block starts just
+  // before an aligned position. The comment is followed by the end-of-document
+  // marker "...\n".
+  emitter << YAML::Newline;
+  const uint64_t pos = os.tellp();
+  const uint64_t end_marker_size = 4;
+  const uint64_t min_comment_size = 2;
+  const uint64_t block_begin =
+      align_up(pos + min_comment_size + end_marker_size +
+                   block_header_prefix_size + min_block_header_size,
+               alignment) -
+      block_header_prefix_size - min_block_header_size;
+  const uint64_t comment_size = block_begin - end_marker_size - pos;
+  // yaml-cpp does not support writing arbitrary comments
+  os << "#" << string(comment_size - min_comment_size, ' ') << "\n";
+}
+
+void writer::align_block(block_info_t &block_info, streamoff pos,
+                         bool have_next) const {
+  const uint64_t alignment = options.block_alignment;
+  if (alignment <= 1)
+    return;
+  // Pad the header so that the data are aligned
+  const uint64_t data_begin = align_up(
+      pos + block_header_prefix_size + min_block_header_size, alignment);
+  const uint64_t header_size = data_begin - pos - block_header_prefix_size;
+  assert(header_size <= numeric_limits<uint16_t>::max());
+  block_info.header_size = header_size;
+  // If the next block's header cannot absorb its padding, then pad this
+  // block instead so that the next block needs no header padding
+  if (have_next) {
+    const uint64_t data_end = data_begin + block_info.used_space;
+    const uint64_t next_header_size =
+        align_up(data_end + block_header_prefix_size + min_block_header_size,
+                 alignment) -
+        data_end - block_header_prefix_size;
+    if (next_header_size > numeric_limits<uint16_t>::max())
+      block_info.allocated_space = block_info.used_space + next_header_size -
+                                   min_block_header_size;
+  }
+}
 
 void writer::flush() {
+  if (!external_blocks.empty())
+    write_external_blocks();
+  if (!blocks.empty())
+    pad_tree();
   emitter << YAML::EndDoc;
-  if (!tasks.empty()) {
+  if (!blocks.empty()) {
     YAML::Emitter index;
     index << YAML::BeginDoc << YAML::Flow << YAML::BeginSeq;
-    for (auto &&task : tasks) {
-      index << os.tellp();
-      std::move(task)(os);
+    if (options.coordinator) {
+      assert(!filename.empty());
+      write_blocks_collective(index);
+    } else if (!filename.empty() && options.nthreads != 1) {
+      write_blocks_parallel(index);
+    } else if (!filename.empty() && options.direct_io.enable) {
+      os.flush();
+      assert(os);
+      direct_streambuf dbuf(filename, os.tellp(), options.direct_io);
+      ostream dos(&dbuf);
+      dos.exceptions(ios::badbit);
+      write_blocks(dos, index);
+      os.seekp(dbuf.close());
+      assert(os);
+    } else {
+      write_blocks(os, index);
     }
-    tasks.clear();
+    blocks.clear();
     index << YAML::EndSeq << YAML::EndDoc;
     // yaml-cpp does not support comments without leading space
     os << "#ASDF BLOCK INDEX\n"
@@ -227,6 +555,211 @@ void writer::flush() {
        << "%YAML 1.1\n"
        << index.c_str();
   }
+  if (options.coordinator) {
+    // The file is complete only when all processes are done
+    os.flush();
+    assert(os);
+    options.coordinator->barrier();
+  }
+}
+
+void writer::write_blocks(ostream &bos, YAML::Emitter &index) {
+  if (options.pipeline_depth <= 0) {
+    for (size_t n = 0; n < blocks.size(); ++n) {
+      auto block = std::move(blocks.at(n))();
+      align_block(block.block_info, bos.tellp(), n + 1 < blocks.size());
+      index << bos.tellp();
+      ndarray::write_block(bos, block);
+    }
+  } else {
+    // Prepare blocks on a separate thread while the previous blocks are
+    // being written
+    mutex mtx;
+    condition_variable cond;
+    deque<prepared_block_t> ready;
+    exception_ptr error;
+    thread preparer([&]() {
+      try {
+        for (auto &&prepare : blocks) {
+          auto block = std::move(prepare)();
+          unique_lock<mutex> lock(mtx);
+          cond.wait(lock, [&]() {
+            return ready.size() < size_t(options.pipeline_depth);
+          });
+          ready.push_back(std::move(block));
+          cond.notify_all();
+        }
+      } catch (...) {
+        lock_guard<mutex> lock(mtx);
+        error = current_exception();
+        cond.notify_all();
+      }
+    });
+    for (size_t n = 0; n < blocks.size(); ++n) {
+      unique_lock<mutex> lock(mtx);
+      cond.wait(lock, [&]() { return !ready.empty() || error; });
+      if (ready.empty())
+        break;
+      auto block = std::move(ready.front());
+      ready.pop_front();
+      cond.notify_all();
+      lock.unlock();
+      align_block(block.block_info, bos.tellp(), n + 1 < blocks.size());
+      index << bos.tellp();
+      ndarray::write_block(bos, block);
+    }
+    preparer.join();
+    if (error) {
+      blocks.clear();
+      rethrow_exception(error);
+    }
+  }
+}
+
+void writer::write_blocks_parallel(YAML::Emitter &index) {
+  const auto prepares = std::move(blocks);
+  blocks.clear();
+  const int64_t nblocks = prepares.size();
+
+  // Prepare (e.g. compress) all blocks in parallel
+  vector<prepared_block_t> prepared(nblocks);
+  parallel_for(nblocks, options.nthreads,
+               [&](int64_t n) { prepared.at(n) = prepares.at(n)(); });
+
+  // Determine the final offsets of all blocks
+  os.flush();
+  assert(os);
+  const streamoff blocks_begin = os.tellp();
+  vector<vector<unsigned char>> headers(nblocks);
+  vector<streamoff> offsets(nblocks);
+  streamoff pos = blocks_begin;
+  for (int64_t n = 0; n < nblocks; ++n) {
+    align_block(prepared.at(n).block_info, pos, n + 1 < nblocks);
+    headers.at(n) = ndarray::encode_block_header(prepared.at(n).block_info);
+    offsets.at(n) = pos;
+    index << pos;
+    pos += headers.at(n).size() + prepared.at(n).block_info.allocated_space;
+  }
+  const streamoff blocks_end = pos;
+
+  // Write all blocks in parallel, each at its final offset
+  const int fd = ::open(filename.c_str(), O_WRONLY);
+  if (fd < 0)
+    throw system_error(errno, generic_category(), filename);
+#ifdef ASDF_HAVE_POSIX_FALLOCATE
+  // This is only an optimization; ignore errors (e.g. if the file system
+  // does not support preallocating)
+  if (blocks_end > blocks_begin)
+    posix_fallocate(fd, blocks_begin, blocks_end - blocks_begin);
+#endif
+  try {
+    parallel_for(nblocks, options.nthreads, [&](int64_t n) {
+      const auto &header = headers.at(n);
+      const auto &block = prepared.at(n);
+      pwrite_all(fd, header.data(), header.size(), offsets.at(n));
+      pwrite_all(fd, block.data->ptr(), block.data->nbytes(),
+                 offsets.at(n) + header.size());
+      // The padding is not written; it reads as zeros
+    });
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  const int ierr = ::close(fd);
+  if (ierr != 0)
+    throw system_error(errno, generic_category(), filename);
+
+  os.seekp(blocks_end);
+  assert(os);
+}
+
+void writer::write_blocks_collective(YAML::Emitter &index) {
+  write_coordinator &coordinator = *options.coordinator;
+  const auto prepares = std::move(blocks);
+  blocks.clear();
+  const int64_t nblocks = prepares.size();
+
+  // Prepare (e.g. compress) the blocks that this process holds
+  vector<prepared_block_t> prepared(nblocks);
+  parallel_for(nblocks, options.nthreads, [&](int64_t n) {
+    if (prepares.at(n))
+      prepared.at(n) = prepares.at(n)();
+  });
+
+  // Exchange the position of the first block (which only process 0 knows)
+  // and the sizes of all blocks
+  os.flush();
+  assert(os);
+  vector<uint64_t> sizes(1 + 2 * nblocks);
+  if (coordinator.rank() == 0)
+    sizes.at(0) = os.tellp();
+  for (int64_t n = 0; n < nblocks; ++n) {
+    if (prepares.at(n)) {
+      sizes.at(1 + 2 * n) = prepared.at(n).block_info.used_space;
+      sizes.at(2 + 2 * n) = prepared.at(n).block_info.allocated_space;
+    }
+  }
+  coordinator.allreduce_sum(sizes);
+
+  // Determine the final offsets of all blocks. All processes arrive at the
+  // same layout.
+  const streamoff blocks_begin = sizes.at(0);
+  vector<vector<unsigned char>> headers(nblocks);
+  vector<streamoff> offsets(nblocks);
+  streamoff pos = blocks_begin;
+  for (int64_t n = 0; n < nblocks; ++n) {
+    block_info_t block_info{};
+    block_info.used_space = sizes.at(1 + 2 * n);
+    block_info.allocated_space = sizes.at(2 + 2 * n);
+    align_block(block_info, pos, n + 1 < nblocks);
+    offsets.at(n) = pos;
+    index << pos;
+    pos += block_header_prefix_size +
+           max(min_block_header_size, uint64_t(block_info.header_size)) +
+           block_info.allocated_space;
+    if (prepares.at(n)) {
+      auto &info = prepared.at(n).block_info;
+      info.header_size = block_info.header_size;
+      info.allocated_space = block_info.allocated_space;
+      headers.at(n) = ndarray::encode_block_header(info);
+      assert(offsets.at(n) + streamoff(headers.at(n).size() +
+                                       info.allocated_space) ==
+             pos);
+    }
+  }
+  const streamoff blocks_end = pos;
+
+  // Write this process' blocks, each at its final offset. Process 0 has
+  // already created the file.
+  const int fd = ::open(filename.c_str(), O_WRONLY);
+  if (fd < 0)
+    throw system_error(errno, generic_category(), filename);
+  try {
+    parallel_for(nblocks, options.nthreads, [&](int64_t n) {
+      if (!prepares.at(n))
+        return;
+      const auto &header = headers.at(n);
+      const auto &block = prepared.at(n);
+      pwrite_all(fd, header.data(), header.size(), offsets.at(n));
+      pwrite_all(fd, block.data->ptr(), block.data->nbytes(),
+                 offsets.at(n) + header.size());
+    });
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  const int ierr = ::close(fd);
+  if (ierr != 0)
+    throw system_error(errno, generic_category(), filename);
+
+  if (coordinator.rank() == 0) {
+    os.seekp(blocks_end);
+    assert(os);
+  }
+}
+
+future<void> writer::flush_async() {
+  return async(launch::async, [this]() { flush(); });
 }
 
 } // namespace ASDF
@@ -33,8 +33,10 @@
 #endif
 
 #include <algorithm>
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <limits>
 #include <type_traits>
 
 namespace ASDF {
@@ -47,26 +49,62 @@ typed_block_t<bool>::typed_block_t(const vector<bool> &data) {
     this->data[i] = data[i];
 }
 
-void parse_inline_array_nd(const YAML::Node &node,
-                           const shared_ptr<datatype_t> &datatype,
-                           const vector<int64_t> &shape, int rank,
-                           vector<unsigned char> &data) {
+namespace {
+// Call `f` for each element of an inline array, in row-major order
+template <typename F>
+void for_each_inline_element(const YAML::Node &node,
+                             const vector<int64_t> &shape, int rank,
+                             const F &f, bool is_compound = false) {
   assert(rank >= 0);
   assert(shape.size() >= rank);
   if (rank == 0) {
-    assert(node.IsScalar());
-    size_t oldsize = data.size();
-    data.resize(oldsize + datatype->type_size());
-    parse_scalar(node, &data[oldsize], datatype);
+    // Records with a compound datatype are sequences
+    assert(is_compound ? node.IsSequence() : node.IsScalar());
+    f(node);
     return;
   }
   int64_t size = shape.at(shape.size() - rank);
   assert(node.IsSequence());
   assert(node.size() == size);
   for (YAML::const_iterator ni = node.begin(), ne = node.end(); ni != ne; ++ni)
-    parse_inline_array_nd(*ni, datatype, shape, rank - 1, data);
+    for_each_inline_element(*ni, shape, rank - 1, f, is_compound);
 }
 
+template <typename T> T load_value(const unsigned char *ptr) {
+  T value;
+  memcpy(&value, ptr, sizeof value);
+  return value;
+}
+template <typename T> void store_value(unsigned char *ptr, const T &value) {
+  memcpy(ptr, &value, sizeof value);
+}
+
+// Parse an element of an inline integer array. Values that
+// `parse_yaml_int` does not handle (e.g. out of range) are left to
+// yaml-cpp.
+template <typename T>
+void parse_int_element(const YAML::Node &elt, unsigned char *ptr) {
+  const auto value = parse_yaml_int(elt.Scalar());
+  if (value && (is_signed<T>::value || *value >= 0) &&
+      int64_t(T(*value)) == *value)
+    store_value(ptr, T(*value));
+  else
+    parse_scalar(elt, ptr, get_scalar_type_id<T>::value);
+}
+
+// Parse an element of an inline floating-point array
+template <typename T>
+void parse_float_element(const YAML::Node &elt, unsigned char *ptr) {
+  const string &str = elt.Scalar();
+  if (const auto value = parse_yaml_float(str))
+    store_value(ptr, T(*value));
+  else if (const auto value = parse_yaml_int(str))
+    store_value(ptr, T(*value));
+  else
+    parse_scalar(elt, ptr, get_scalar_type_id<T>::value);
+}
+} // namespace
+
 void parse_inline_array(const YAML::Node &node, shared_ptr<block_t> &data,
                         const bool have_datatype,
                         shared_ptr<datatype_t> &datatype, const bool have_shape,
@@ -76,11 +114,12 @@ void parse_inline_array(const YAML::Node &node, shared_ptr<block_t> &data,
     shape.clear();
     YAML::Node n = node;
     while (n.IsSequence()) {
-      shape.insert(shape.begin(), n.size());
+      shape.push_back(n.size());
       // This method does not work if the array size is zero in one dimension
-      if (shape[0] == 0)
+      if (shape.back() == 0)
         break;
-      n = n[0];
+      // Assigning would overwrite the node; rebind it instead
+      n.reset(n[0]);
     }
     assert(n.IsScalar());
   }
@@ -89,102 +128,175 @@ void parse_inline_array(const YAML::Node &node, shared_ptr<block_t> &data,
     npoints *= shape[d];
   vector<unsigned char> data1;
   if (!have_datatype) {
-    // determine datatype while parsing
-    try {
-      datatype = make_shared<datatype_t>(id_int64);
-      data1.reserve(npoints * datatype->type_size());
-      parse_inline_array_nd(node, datatype, shape, shape.size(), data1);
-    } catch (YAML::RepresentationException) {
-      try {
-        datatype = make_shared<datatype_t>(id_float64);
-        data1.reserve(npoints * datatype->type_size());
-        parse_inline_array_nd(node, datatype, shape, shape.size(), data1);
-      } catch (YAML::RepresentationException) {
-        try {
-          datatype = make_shared<datatype_t>(id_complex128);
-          data1.reserve(npoints * datatype->type_size());
-          parse_inline_array_nd(node, datatype, shape, shape.size(), data1);
-        } catch (YAML::RepresentationException) {
-          // bool8_t
-          // ucs4_t
-          assert(0);
+    // Determine the datatype while parsing. We start with int64, and widen
+    // the elements parsed so far to float64 or complex128 when necessary.
+    const string complex_tag = "tag:stsci.edu:asdf/core/complex-1.0.0";
+    scalar_type_id_t type = id_int64;
+    data1.resize(npoints * sizeof(int64_t));
+    // Integers such as "0x10" are not valid floating-point numbers
+    const auto parse_real = [](const string &str) -> optional<float64_t> {
+      if (const auto value = parse_yaml_float(str))
+        return value;
+      if (const auto value = parse_yaml_int(str))
+        return float64_t(*value);
+      return {};
+    };
+    int64_t n = 0;
+    for_each_inline_element(node, shape, shape.size(), [&](const auto &elt) {
+      const bool is_complex = elt.Tag() == complex_tag;
+      if (type == id_int64) {
+        if (const auto value =
+                is_complex ? nullopt : parse_yaml_int(elt.Scalar())) {
+          store_value(&data1[n++ * sizeof(int64_t)], *value);
+          return;
         }
+        // int64 and float64 have the same size
+        for (int64_t i = 0; i < n; ++i) {
+          unsigned char *const ptr = &data1[i * sizeof(int64_t)];
+          store_value(ptr, float64_t(load_value<int64_t>(ptr)));
+        }
+        type = id_float64;
       }
-    }
+      if (type == id_float64) {
+        if (const auto value =
+                is_complex ? nullopt : parse_real(elt.Scalar())) {
+          store_value(&data1[n++ * sizeof(float64_t)], *value);
+          return;
+        }
+        // Widen backwards since complex128 is larger than float64
+        data1.resize(npoints * sizeof(complex128_t));
+        for (int64_t i = n - 1; i >= 0; --i) {
+          const auto re = load_value<float64_t>(&data1[i * sizeof(float64_t)]);
+          store_value(&data1[i * sizeof(complex128_t)], complex128_t(re));
+        }
+        type = id_complex128;
+      }
+      complex128_t value;
+      if (is_complex) {
+        yaml_decode(elt, value);
+      } else {
+        const auto re = parse_real(elt.Scalar());
+        // bool8_t
+        // ucs4_t
+        assert(re);
+        value = *re;
+      }
+      store_value(&data1[n++ * sizeof(complex128_t)], value);
+    });
+    assert(n == npoints);
+    datatype = make_shared<datatype_t>(type);
   } else {
     // parse data, expecting a particular datatype
-    data1.reserve(npoints * datatype->type_size());
-    parse_inline_array_nd(node, datatype, shape, shape.size(), data1);
+    const size_t type_size = datatype->type_size();
+    data1.resize(npoints * type_size);
+    const auto parse_elements = [&](const auto &parse) {
+      unsigned char *ptr = data1.data();
+      const auto parse_element = [&](const YAML::Node &elt) {
+        parse(elt, ptr);
+        ptr += type_size;
+      };
+      for_each_inline_element(node, shape, shape.size(), parse_element,
+                              !datatype->is_scalar);
+      assert(ptr == data1.data() + data1.size());
+    };
+    // Integers and reals are parsed without yaml-cpp; other datatypes
+    // (booleans, complex numbers, and records) via `parse_scalar`
+    const auto parse_other = [&](const YAML::Node &elt, unsigned char *ptr) {
+      parse_scalar(elt, ptr, datatype);
+    };
+    switch (datatype->is_scalar ? datatype->scalar_type_id : id_error) {
+    case id_int8:
+      parse_elements(parse_int_element<int8_t>);
+      break;
+    case id_int16:
+      parse_elements(parse_int_element<int16_t>);
+      break;
+    case id_int32:
+      parse_elements(parse_int_element<int32_t>);
+      break;
+    case id_int64:
+      parse_elements(parse_int_element<int64_t>);
+      break;
+    case id_uint8:
+      parse_elements(parse_int_element<uint8_t>);
+      break;
+    case id_uint16:
+      parse_elements(parse_int_element<uint16_t>);
+      break;
+    case id_uint32:
+      parse_elements(parse_int_element<uint32_t>);
+      break;
+    case id_uint64:
+      parse_elements(parse_int_element<uint64_t>);
+      break;
+    case id_float32:
+      parse_elements(parse_float_element<float32_t>);
+      break;
+    case id_float64:
+      parse_elements(parse_float_element<float64_t>);
+      break;
+    default:
+      parse_elements(parse_other);
+      break;
+    }
   }
   data = make_shared<typed_block_t<unsigned char>>(std::move(data1));
 }
 
-YAML::Node emit_inline_array(const unsigned char *data,
-                             const shared_ptr<datatype_t> &datatype,
-                             byteorder_t byteorder,
-                             const vector<int64_t> &shape,
-                             const vector<int64_t> &strides) {
-  size_t rank = shape.size();
+// Write an inline array directly to the emitter, in flow style, without
+// building a YAML node for it
+void emit_inline_array(writer &w, const unsigned char *data,
+                       const shared_ptr<datatype_t> &datatype,
+                       byteorder_t byteorder, const vector<int64_t> &shape,
+                       const vector<int64_t> &strides, size_t dim = 0) {
+  const size_t rank = shape.size();
   assert(strides.size() == rank);
-  if (rank == 0) {
-    // 0-dimensional array
-    YAML::Node node;
-    node.SetStyle(YAML::EmitterStyle::Flow);
-    // node = data.at(offset);
-    node = emit_scalar(data, datatype, byteorder);
-    return node;
-  }
-  if (rank == 1) {
-    // 1-dimensional array
-    YAML::Node node;
-    // node.SetStyle(YAML::EmitterStyle::Flow);
-    for (size_t i = 0; i < shape.at(0); ++i)
-      node[i] = emit_scalar(data + i * strides.at(0), datatype, byteorder);
-    return node;
-  }
-  // multi-dimensional array
-  YAML::Node node;
-  // TODO: Try emitting these as Flow, with a Newline at the end
-  vector<int64_t> shape1(rank - 1);
-  for (size_t d = 0; d < rank - 1; ++d)
-    shape1.at(d) = shape.at(d + 1);
-  vector<int64_t> strides1(rank - 1);
-  for (size_t d = 0; d < rank - 1; ++d)
-    strides1.at(d) = strides.at(d + 1);
-  for (size_t i = 0; i < shape.at(0); ++i)
-    node[i] = emit_inline_array(data + i * strides.at(0), datatype, byteorder,
-                                shape1, strides1);
-  return node;
+  if (dim == rank) {
+    const string str =
+        datatype->is_scalar
+            ? format_scalar(data, datatype->scalar_type_id, byteorder)
+            : string();
+    if (!str.empty())
+      w << str;
+    else if (datatype->is_scalar && datatype->scalar_type_id == id_complex64)
+      w << xtoh<complex64_t>(data, byteorder);
+    else if (datatype->is_scalar && datatype->scalar_type_id == id_complex128)
+      w << xtoh<complex128_t>(data, byteorder);
+    else
+      w << emit_scalar(data, datatype, byteorder);
+    return;
+  }
+  w << YAML::Flow << YAML::BeginSeq;
+  for (int64_t i = 0; i < shape.at(dim); ++i)
+    emit_inline_array(w, data + i * strides.at(dim), datatype, byteorder, shape,
+                      strides, dim + 1);
+  w << YAML::EndSeq;
 }
 
 // (Incidentally, this spells "SBLK", with the highest bit of the "S" set to
 // one)
 constexpr array<unsigned char, 4> block_magic_token{0xd3, 0x42, 0x4c, 0x4b};
 
-template <typename T> void input(istream &is, T &data) {
+template <typename T> void input(const unsigned char *&ptr, T &data) {
   // Always input in big-endian as required for the header
   static_assert(std::is_integral<T>::value, "");
   using U = typename std::make_unsigned<T>::type;
   data = 0;
-  for (ptrdiff_t i = sizeof(T) - 1; i >= 0; --i) {
-    unsigned char ch;
-    is.read(reinterpret_cast<char *>(&ch), 1);
-    data = (U(data) << 8) | ch;
-  }
+  for (ptrdiff_t i = sizeof(T) - 1; i >= 0; --i)
+    data = (U(data) << 8) | *ptr++;
 }
 
 shared_ptr<block_t>
-read_block_data(const shared_ptr<istream> &pis, streamoff block_begin,
-                uint64_t allocated_space, uint64_t data_space,
-                compression_t compression,
-                const array<unsigned char, 16> &want_checksum) {
-  istream &is = *pis;
-  assert(is);
-  is.seekg(block_begin);
-  assert(is);
-  vector<unsigned char> indata(allocated_space);
-  is.read(reinterpret_cast<char *>(indata.data()), indata.size());
-  assert(is);
+ndarray::decode_block(const shared_ptr<block_t> &inblock,
+                      const block_info_t &block_info) {
+  const uint64_t used_space = block_info.used_space;
+  const uint64_t data_space = block_info.data_space;
+  const compression_t compression = block_info.compression;
+  const array<unsigned char, 16> &want_checksum = block_info.checksum;
+  assert(inblock->nbytes() == used_space);
+  const unsigned char *const inptr =
+      static_cast<const unsigned char *>(inblock->ptr());
+  const size_t insize = inblock->nbytes();
 
   // check checksum
 #ifdef ASDF_HAVE_OPENSSL
@@ -195,7 +307,7 @@ read_block_data(const shared_ptr<istream> &pis, streamoff block_begin,
     assert(mdctx);
     int ires = EVP_DigestInit_ex(mdctx, EVP_md5(), NULL);
     assert(ires == 1);
-    ires = EVP_DigestUpdate(mdctx, indata.data(), indata.size());
+    ires = EVP_DigestUpdate(mdctx, inptr, insize);
     assert(ires == 1);
     assert(EVP_MD_size(EVP_md5()) == checksum.size());
     unsigned int digest_size;
@@ -212,16 +324,15 @@ read_block_data(const shared_ptr<istream> &pis, streamoff block_begin,
   switch (compression) {
 
   case compression_t::none:
-    assert(data_space == allocated_space);
-    data = std::move(indata);
-    break;
+    assert(data_space == used_space);
+    return inblock;
 
 #ifdef ASDF_HAVE_BLOSC
   case compression_t::blosc: {
     const int numinternalthreads = 1;
     data.resize(data_space);
     assert(data.size() <= size_t(INT_MAX));
-    int dsize = blosc_decompress_ctx(indata.data(), data.data(), data.size(),
+    int dsize = blosc_decompress_ctx(inptr, data.data(), data.size(),
                                      numinternalthreads);
     assert(dsize > 0);
     assert(dsize == data.size());
@@ -234,7 +345,7 @@ read_block_data(const shared_ptr<istream> &pis, streamoff block_begin,
     blosc2_storage storage = BLOSC2_STORAGE_DEFAULTS;
     // TODO: Don't copy the data
     blosc2_schunk *const schunk =
-        blosc2_schunk_from_buffer(indata.data(), indata.size(), false);
+        blosc2_schunk_from_buffer(const_cast<uint8_t *>(inptr), insize, false);
     blosc2_schunk_avoid_cframe_free(schunk, true);
     data.resize(data_space);
     uint8_t *output_ptr = data.data();
@@ -263,9 +374,9 @@ read_block_data(const shared_ptr<istream> &pis, streamoff block_begin,
     strm.opaque = NULL;
     BZ2_bzDecompressInit(&strm, 0, 0);
     strm.next_in =
-        reinterpret_cast<char *>(const_cast<unsigned char *>(indata.data()));
+        reinterpret_cast<char *>(const_cast<unsigned char *>(inptr));
     strm.next_out = reinterpret_cast<char *>(data.data());
-    uint64_t avail_in = indata.size();
+    uint64_t avail_in = insize;
     uint64_t avail_out = data.size();
     for (;;) {
       uint64_t this_avail_in =
@@ -308,9 +419,9 @@ read_block_data(const shared_ptr<istream> &pis, streamoff block_begin,
     assert(dctx);
 
     size_t dstSize = data.size();
-    size_t srcSize = indata.size();
+    size_t srcSize = insize;
     const std::size_t nbytes_expected = LZ4F_decompress(
-        dctx, data.data(), &dstSize, indata.data(), &srcSize, &dOpt);
+        dctx, data.data(), &dstSize, inptr, &srcSize, &dOpt);
     assert(nbytes_expected == 0);
 
     ierr = LZ4F_freeDecompressionContext(dctx);
@@ -327,9 +438,9 @@ read_block_data(const shared_ptr<istream> &pis, streamoff block_begin,
     strm.zfree = NULL;
     strm.opaque = NULL;
     inflateInit(&strm);
-    strm.next_in = const_cast<unsigned char *>(indata.data());
+    strm.next_in = const_cast<unsigned char *>(inptr);
     strm.next_out = data.data();
-    uint64_t avail_in = indata.size();
+    uint64_t avail_in = insize;
     uint64_t avail_out = data.size();
     for (;;) {
       uint64_t this_avail_in =
@@ -359,29 +470,27 @@ read_block_data(const shared_ptr<istream> &pis, streamoff block_begin,
   return make_shared<typed_block_t<unsigned char>>(std::move(data));
 }
 
-std::tuple<memoized<block_t>, block_info_t>
-ndarray::read_block(const shared_ptr<istream> &pis) {
-  istream &is = *pis;
+block_info_t ndarray::decode_block_header(const unsigned char *header,
+                                          size_t size) {
+  assert(size >= block_header_prefix_size + block_header_fields_size);
+  const unsigned char *ptr = header;
   // block_magic_token
   array<unsigned char, 4> token;
   for (auto &ch : token)
-    input(is, ch);
-  if (token != block_magic_token) {
-    is.seekg(-int64_t(token.size()), ios_base::cur);
-    return {};
-  }
+    input(ptr, ch);
+  assert(token == block_magic_token);
   // header_size
   uint16_t header_size;
-  input(is, header_size);
-  auto header_prefix_end = is.tellg();
+  input(ptr, header_size);
+  const unsigned char *const header_prefix_end = ptr;
   // flags
   uint32_t flags;
-  input(is, flags);
+  input(ptr, flags);
   assert(flags == 0);
   // compression
   array<unsigned char, 4> comp;
   for (auto &ch : comp)
-    input(is, ch);
+    input(ptr, ch);
   // TODO: Remember compression
   compression_t compression;
   if ((comp == array<unsigned char, 4>{0, 0, 0, 0}))
@@ -402,41 +511,62 @@ ndarray::read_block(const shared_ptr<istream> &pis) {
     assert(0);
   // allocated_space
   uint64_t allocated_space;
-  input(is, allocated_space);
+  input(ptr, allocated_space);
   // used_space
   uint64_t used_space;
-  input(is, used_space);
-  assert(used_space >= allocated_space);
+  input(ptr, used_space);
+  assert(allocated_space >= used_space);
   // data_space
   uint64_t data_space;
-  input(is, data_space);
+  input(ptr, data_space);
   // checksum
   array<unsigned char, 16> checksum;
   for (auto &ch : checksum)
-    input(is, ch);
+    input(ptr, ch);
   // finish reading header
-  auto header_end = is.tellg();
-  int64_t header_read = header_end - header_prefix_end;
+  int64_t header_read = ptr - header_prefix_end;
   assert(header_read <= header_size);
-  if (header_read < header_size)
-    is.seekg(header_size - header_read, ios_base::cur);
+
+  return block_info_t{
+      token,       header_size,     header_read, flags,      comp,
+      compression, allocated_space, used_space,  data_space, checksum,
+  };
+}
+
+std::tuple<memoized<block_t>, block_info_t>
+ndarray::read_block(const shared_ptr<shared_istream> &psis) {
+  istream &is = psis->get_istream();
+  // Read the fixed part of the header at once
+  const streamoff block_pos = is.tellg();
+  array<unsigned char, block_header_prefix_size + block_header_fields_size>
+      header;
+  is.read(reinterpret_cast<char *>(header.data()), header.size());
+  const size_t header_length = is.gcount();
+  if (header_length < block_magic_token.size() ||
+      !equal(block_magic_token.begin(), block_magic_token.end(),
+             header.begin())) {
+    // This is not a block
+    is.clear();
+    is.seekg(block_pos);
+    return {};
+  }
+  assert(header_length == header.size());
+  const block_info_t block_info =
+      decode_block_header(header.data(), header.size());
+
   // read data
-  auto block_begin = is.tellg();
+  const streamoff block_begin =
+      block_pos + block_header_prefix_size + block_info.header_size;
+  const uint64_t used_space = block_info.used_space;
   auto fdata = memoized<block_t>([=]() {
-    return read_block_data(pis, block_begin, allocated_space, data_space,
-                           compression, checksum);
+    return decode_block(psis->read(block_begin, used_space), block_info);
   });
   // This would ensure synchronous reading, which might be useful for
   // debugging
   // fdata.fill_cache();
 
   // skip padding
-  is.seekg(block_begin + streamoff(used_space));
-
-  block_info_t block_info{
-      token,       header_size,     header_read, flags,      comp,
-      compression, allocated_space, used_space,  data_space, checksum,
-  };
+  is.seekg(block_begin + streamoff(block_info.allocated_space));
 
   return {fdata, block_info};
 }
@@ -450,33 +580,22 @@ void output(vector<unsigned char> &header, const T &data) {
     header.push_back((U(data) >> (8 * i)) & 0xff);
 }
 
-// TODO: stream the block (e.g. when compressing), then write the correct
-// header later
-void ndarray::write_block(ostream &os) const {
-  vector<unsigned char> header;
-  // block_magic_token
-  for (auto ch : block_magic_token)
-    output(header, ch);
-  // header_size (not yet known)
-  auto header_size_pos = header.size();
-  uint16_t unknown_header_size = 0;
-  output(header, unknown_header_size);
-  auto header_prefix_length = header.size();
-  // flags
-  uint32_t flags = 0;
-  output(header, flags);
+// TODO: stream the block (e.g. when compressing)
+prepared_block_t ndarray::prepare_block() const {
   // compression
   array<unsigned char, 4> comp;
   shared_ptr<block_t> outdata;
 
   // storage management
   const bool old_ready = get_data().ready();
+  // Access the data only once, since other threads might also access them
+  const shared_ptr<block_t> indata = get_data().get();
 
   switch (compression) {
 
   case compression_t::none:
     comp = {0, 0, 0, 0};
-    outdata = get_data().get();
+    outdata = indata;
     break;
 
 #ifdef ASDF_HAVE_BLOSC
@@ -484,26 +603,26 @@ void ndarray::write_block(ostream &os) const {
     comp = {'b', 'l', 's', 'c'};
     const int level = compression_level;
     const int doshuffle = BLOSC_BITSHUFFLE;
-    const size_t typesize = get_scalar_type_size(datatype->scalar_type_id);
+    const size_t typesize = datatype->type_size();
     const char *const compressor = BLOSC_BLOSCLZ_COMPNAME;
     const int blocksize = 0;
     const int numinternalthreads = 1;
 
-    assert(get_data()->nbytes() <= size_t(INT_MAX));
+    assert(indata->nbytes() <= size_t(INT_MAX));
 
     // Allocate `BLOSC_MAX_OVERHEAD` more
     outdata = make_shared<typed_block_t<unsigned char>>(
-        vector<unsigned char>(get_data()->nbytes() + BLOSC_MAX_OVERHEAD));
+        vector<unsigned char>(indata->nbytes() + BLOSC_MAX_OVERHEAD));
     int bytes_written =
-        blosc_compress_ctx(level, doshuffle, typesize, get_data()->nbytes(),
-                           get_data()->ptr(), outdata->ptr(), outdata->nbytes(),
+        blosc_compress_ctx(level, doshuffle, typesize, indata->nbytes(),
+                           indata->ptr(), outdata->ptr(), outdata->nbytes(),
                            compressor, blocksize, numinternalthreads);
     assert(bytes_written > 0);
     outdata->resize(bytes_written);
-    if (outdata->nbytes() >= get_data()->nbytes()) {
+    if (outdata->nbytes() >= indata->nbytes()) {
       // Skip compression if it does not reduce the size
       comp = {0, 0, 0, 0};
-      outdata = get_data().get();
+      outdata = indata;
     }
     break;
   }
@@ -516,7 +635,7 @@ void ndarray::write_block(ostream &os) const {
     blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
     cparams.compcode = BLOSC_BLOSCLZ;
     cparams.clevel = compression_level;
-    cparams.typesize = get_scalar_type_size(datatype->scalar_type_id);
+    cparams.typesize = datatype->type_size();
     cparams.nthreads = 1;
     cparams.filters[BLOSC2_MAX_FILTERS - 1] = BLOSC_BITSHUFFLE;
 
@@ -529,8 +648,8 @@ void ndarray::write_block(ostream &os) const {
     blosc2_schunk *const schunk = blosc2_schunk_new(&storage);
 
     const int64_t chunk_size = INT_MAX - BLOSC2_MAX_OVERHEAD;
-    uint8_t *input_ptr = static_cast<uint8_t *>(get_data()->ptr());
-    int64_t total_input_size = get_data()->nbytes();
+    uint8_t *input_ptr = static_cast<uint8_t *>(indata->ptr());
+    int64_t total_input_size = indata->nbytes();
     while (total_input_size > 0) {
       using std::min;
       const int input_size = min(total_input_size, chunk_size);
@@ -563,7 +682,7 @@ void ndarray::write_block(ostream &os) const {
     comp = {'b', 'z', 'p', '2'};
     // Allocate 600 bytes plus 1% more
     outdata = make_shared<typed_block_t<unsigned char>>(vector<unsigned char>(
-        600 + get_data()->nbytes() + (get_data()->nbytes() + 99) / 100));
+        600 + indata->nbytes() + (indata->nbytes() + 99) / 100));
     const int level = compression_level;
     bz_stream strm;
     strm.bzalloc = NULL;
@@ -571,9 +690,9 @@ void ndarray::write_block(ostream &os) const {
     strm.opaque = NULL;
     BZ2_bzCompressInit(&strm, level, 0, 0);
     strm.next_in =
-        reinterpret_cast<char *>(const_cast<void *>(get_data()->ptr()));
+        reinterpret_cast<char *>(const_cast<void *>(indata->ptr()));
     strm.next_out = reinterpret_cast<char *>(outdata->ptr());
-    uint64_t avail_in = get_data()->nbytes();
+    uint64_t avail_in = indata->nbytes();
     uint64_t avail_out = outdata->nbytes();
     for (;;) {
       uint64_t this_avail_in =
@@ -592,10 +711,10 @@ void ndarray::write_block(ostream &os) const {
     }
     assert(avail_in == 0);
     outdata->resize(outdata->nbytes() - avail_out);
-    if (outdata->nbytes() >= get_data()->nbytes()) {
+    if (outdata->nbytes() >= indata->nbytes()) {
       // Skip compression if it does not reduce the size
       comp = {0, 0, 0, 0};
-      outdata = get_data().get();
+      outdata = indata;
     }
     break;
   }
@@ -609,13 +728,13 @@ void ndarray::write_block(ostream &os) const {
     preferences.compressionLevel = compression_level;
 
     const size_t max_nbytes =
-        LZ4F_compressFrameBound(get_data()->nbytes(), &preferences);
+        LZ4F_compressFrameBound(indata->nbytes(), &preferences);
     outdata = make_shared<typed_block_t<unsigned char>>(
         vector<unsigned char>(max_nbytes));
 
     const size_t nbytes =
-        LZ4F_compressFrame(outdata->ptr(), outdata->nbytes(), get_data()->ptr(),
-                           get_data()->nbytes(), &preferences);
+        LZ4F_compressFrame(outdata->ptr(), outdata->nbytes(), indata->ptr(),
+                           indata->nbytes(), &preferences);
     outdata->resize(nbytes);
     break;
   }
@@ -626,8 +745,8 @@ void ndarray::write_block(ostream &os) const {
     comp = {'z', 'l', 'i', 'b'};
     // Allocate 6 bytes plus 5 bytes per 16 kByte more
     outdata = make_shared<typed_block_t<unsigned char>>(
-        vector<unsigned char>((6 + get_data()->nbytes() +
-                               (get_data()->nbytes() + 16383) / 16384 * 5)));
+        vector<unsigned char>((6 + indata->nbytes() +
+                               (indata->nbytes() + 16383) / 16384 * 5)));
     const int level = compression_level;
     z_stream strm;
     strm.zalloc = Z_NULL;
@@ -636,9 +755,9 @@ void ndarray::write_block(ostream &os) const {
     int iret = deflateInit(&strm, level);
     assert(iret == Z_OK);
     strm.next_in = reinterpret_cast<unsigned char *>(
-        const_cast<void *>(get_data()->ptr()));
+        const_cast<void *>(indata->ptr()));
     strm.next_out = reinterpret_cast<unsigned char *>(outdata->ptr());
-    uint64_t avail_in = get_data()->nbytes();
+    uint64_t avail_in = indata->nbytes();
     uint64_t avail_out = outdata->nbytes();
     for (;;) {
       uint64_t this_avail_in =
@@ -657,10 +776,10 @@ void ndarray::write_block(ostream &os) const {
     }
     assert(avail_in == 0);
     outdata->resize(outdata->nbytes() - avail_out);
-    if (outdata->nbytes() >= get_data()->nbytes()) {
+    if (outdata->nbytes() >= indata->nbytes()) {
       // Skip compression if it does not reduce the size
       comp = {0, 0, 0, 0};
-      outdata = get_data().get();
+      outdata = indata;
     }
     break;
   }
@@ -670,17 +789,12 @@ void ndarray::write_block(ostream &os) const {
     assert(0);
   }
 
-  for (auto ch : comp)
-    output(header, ch);
   // allocated_space
   uint64_t allocated_space = outdata->nbytes();
-  output(header, allocated_space);
   // used_space
   uint64_t used_space = allocated_space; // no padding
-  output(header, used_space);
   // data_space
-  uint64_t data_space = get_data()->nbytes();
-  output(header, data_space);
+  uint64_t data_space = indata->nbytes();
 
   // checksum
   array<unsigned char, 16> checksum;
@@ -700,8 +814,52 @@ void ndarray::write_block(ostream &os) const {
 #else
   checksum = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 #endif
-  for (auto ch : checksum)
+
+  // storage management
+  // (`outdata` keeps the data alive if they are written uncompressed)
+  if (!old_ready)
+    get_data().forget();
+
+  const compression_t block_compression =
+      comp == array<unsigned char, 4>{0, 0, 0, 0} ? compression_t::none
+                                                  : compression;
+  // The header size is only determined when the block is written
+  block_info_t block_info{
+      block_magic_token, 0,               0,          0,          comp,
+      block_compression, allocated_space, used_space, data_space, checksum,
+  };
+
+  return {block_info, std::move(outdata)};
+}
+
+vector<unsigned char>
+ndarray::encode_block_header(const block_info_t &block_info) {
+  vector<unsigned char> header;
+  // block_magic_token
+  for (auto ch : block_magic_token)
     output(header, ch);
+  // header_size (not yet known)
+  auto header_size_pos = header.size();
+  uint16_t unknown_header_size = 0;
+  output(header, unknown_header_size);
+  auto header_prefix_length = header.size();
+  // flags
+  output(header, block_info.flags);
+  // compression
+  for (auto ch : block_info.comp)
+    output(header, ch);
+  // allocated_space
+  output(header, block_info.allocated_space);
+  // used_space
+  output(header, block_info.used_space);
+  // data_space
+  output(header, block_info.data_space);
+  // checksum
+  for (auto ch : block_info.checksum)
+    output(header, ch);
+  // padding (e.g. to align the data)
+  while (header.size() - header_prefix_length < block_info.header_size)
+    header.push_back(0);
 
   // fill in header_size
   uint16_t header_size = header.size() - header_prefix_length;
@@ -709,18 +867,22 @@ void ndarray::write_block(ostream &os) const {
   output(header_size_buf, header_size);
   for (size_t p = 0; p < header_size_buf.size(); ++p)
     header.at(header_size_pos + p) = header_size_buf.at(p);
+
+  return header;
+}
+
+void ndarray::write_block(ostream &os, const prepared_block_t &block) {
+  const block_info_t &block_info = block.block_info;
   // write header
+  const vector<unsigned char> header = encode_block_header(block_info);
   os.write(reinterpret_cast<const char *>(header.data()), header.size());
 
   // write data
-  os.write(reinterpret_cast<const char *>(outdata->ptr()), outdata->nbytes());
-
-  // storage management
-  if (!old_ready)
-    get_data().forget();
+  os.write(reinterpret_cast<const char *>(block.data->ptr()),
+           block.data->nbytes());
 
   // write padding
-  vector<char> padding(allocated_space - used_space);
+  vector<char> padding(block_info.allocated_space - block_info.used_space);
   os.write(padding.data(), padding.size());
 }
 
@@ -739,8 +901,11 @@ ndarray::ndarray(const shared_ptr<reader_state> &rs, const YAML::Node &node)
   switch (block_format) {
 
   case block_format_t::block: {
-    int64_t source;
-    yaml_decode(node["source"], source);
+    // The source is either a block index, or the name of an exploded file
+    const YAML::Node &source_node = node["source"];
+    const auto source = source_node.Tag() == "!"
+                            ? nullopt
+                            : parse_yaml_int(source_node.Scalar());
     // TODO: This is just a default choice
     compression = compression_t::zlib;
     compression_level = 9;
@@ -762,8 +927,35 @@ ndarray::ndarray(const shared_ptr<reader_state> &rs, const YAML::Node &node)
         str *= shape.at(d);
       }
     }
-    mdata = rs->get_block(source);
-    block_info = std::make_optional<block_info_t>(rs->get_block_info(source));
+    if (node["statistics"].IsDefined())
+      yaml_decode(node["statistics"], statistics.emplace());
+    if (source) {
+      mdata = rs->get_block(*source);
+      block_info =
+          std::make_optional<block_info_t>(rs->get_block_info(*source));
+    } else {
+      // The data are the first block of the exploded file. That file is
+      // only opened when the data or the block info are accessed.
+      const string filename = source_node.Scalar();
+      const memoized<reader_state> ext(
+          [=]() { return rs->get_external_file(filename); });
+      const memoized<block_info_t> info([=]() {
+        return make_shared<block_info_t>(ext->get_block_info(0));
+      });
+      exploded_block_info = info;
+      mdata = memoized<block_t>([=]() {
+        if (!info.ready())
+          info.set(make_shared<block_info_t>(ext->get_block_info(0)));
+        // Do not keep the data in the exploded file's block as well, so
+        // that forgetting this array's data releases them
+        const auto block = ext->get_block(0);
+        const bool was_ready = block.ready();
+        const auto data = block.get();
+        if (!was_ready)
+          block.forget();
+        return data;
+      });
+    }
     break;
   }
 
@@ -805,20 +997,447 @@ ndarray::ndarray(const copy_state &cs, const ndarray &arr) : ndarray(arr) {
     compression_level = cs.compression_level;
 }
 
+// Statistics
+
+YAML::Node yaml_encode(const statistics_t &statistics) {
+  YAML::Node node;
+  node["count"] = statistics.count;
+  node["nan_count"] = statistics.nan_count;
+  node["inf_count"] = statistics.inf_count;
+  if (statistics.min)
+    node["min"] = yaml_encode(*statistics.min);
+  if (statistics.max)
+    node["max"] = yaml_encode(*statistics.max);
+  node.SetStyle(YAML::EmitterStyle::Flow);
+  return node;
+}
+
+void yaml_decode(const YAML::Node &node, statistics_t &statistics) {
+  yaml_decode(node["count"], statistics.count);
+  yaml_decode(node["nan_count"], statistics.nan_count);
+  yaml_decode(node["inf_count"], statistics.inf_count);
+  statistics.min.reset();
+  statistics.max.reset();
+  if (node["min"].IsDefined())
+    yaml_decode(node["min"], statistics.min.emplace());
+  if (node["max"].IsDefined())
+    yaml_decode(node["max"], statistics.max.emplace());
+}
+
+namespace {
+// Round a value to float64, such that the result is not larger (if `up` is
+// false) or not smaller (if `up` is true) than the value
+template <typename T> float64_t round_outwards(T val, bool up) {
+  float64_t res = float64_t(val);
+  if constexpr (is_integral_v<T>) {
+    // long double can represent all 64-bit integers exactly
+    const long double exact = val;
+    if (up ? (long double)res < exact : (long double)res > exact)
+      res = nextafter(res, up ? numeric_limits<float64_t>::infinity()
+                              : -numeric_limits<float64_t>::infinity());
+  }
+  return res;
+}
+
+template <typename T>
+statistics_t calculate_statistics(const unsigned char *ptr,
+                                  const vector<int64_t> &shape,
+                                  const vector<int64_t> &strides,
+                                  bool need_swap) {
+  const int rank = shape.size();
+  statistics_t stats;
+  stats.count = 1;
+  for (const auto n : shape)
+    stats.count *= n;
+  if (stats.count == 0)
+    return stats;
+
+  bool have_range = false;
+  T min_val{}, max_val{};
+  // Process a run of `n` elements that are `stride` bytes apart
+  const auto process_run = [&](const unsigned char *run, int64_t n,
+                               int64_t stride) {
+    T run_min, run_max;
+    if constexpr (is_floating_point_v<T>) {
+      run_min = numeric_limits<T>::infinity();
+      run_max = -numeric_limits<T>::infinity();
+    } else {
+      run_min = numeric_limits<T>::max();
+      run_max = numeric_limits<T>::lowest();
+    }
+    int64_t nan_count = 0, inf_count = 0;
+    if (!need_swap && stride == sizeof(T)) {
+      // Fast path for contiguous elements in host byte order, which the
+      // compiler can vectorize
+      const T *const elts = reinterpret_cast<const T *>(run);
+      if constexpr (is_floating_point_v<T>) {
+        for (int64_t i = 0; i < n; ++i) {
+          const T elt = elts[i];
+          nan_count += isnan(elt);
+          inf_count += isinf(elt);
+          // Comparisons with NaN are false
+          run_min = elt < run_min ? elt : run_min;
+          run_max = elt > run_max ? elt : run_max;
+        }
+      } else {
+        for (int64_t i = 0; i < n; ++i) {
+          run_min = min(run_min, elts[i]);
+          run_max = max(run_max, elts[i]);
+        }
+      }
+    } else {
+      for (int64_t i = 0; i < n; ++i) {
+        unsigned char bytes[sizeof(T)];
+        memcpy(bytes, run + i * stride, sizeof(T));
+        if (need_swap)
+          reverse(bytes, bytes + sizeof(T));
+        T elt;
+        memcpy(&elt, bytes, sizeof(T));
+        if constexpr (is_floating_point_v<T>) {
+          nan_count += isnan(elt);
+          inf_count += isinf(elt);
+        }
+        run_min = elt < run_min ? elt : run_min;
+        run_max = elt > run_max ? elt : run_max;
+      }
+    }
+    stats.nan_count += nan_count;
+    stats.inf_count += inf_count;
+    if (nan_count == n)
+      return;
+    min_val = have_range ? min(min_val, run_min) : run_min;
+    max_val = have_range ? max(max_val, run_max) : run_max;
+    have_range = true;
+  };
+
+  if (rank == 0) {
+    process_run(ptr, 1, sizeof(T));
+  } else {
+    // Loop over all runs along the last dimension
+    vector<int64_t> idx(rank, 0);
+    for (;;) {
+      const unsigned char *run = ptr;
+      for (int d = 0; d < rank - 1; ++d)
+        run += idx[d] * strides[d];
+      process_run(run, shape[rank - 1], strides[rank - 1]);
+      int d = rank - 2;
+      for (; d >= 0; --d) {
+        if (++idx[d] < shape[d])
+          break;
+        idx[d] = 0;
+      }
+      if (d < 0)
+        break;
+    }
+  }
+
+  if (have_range) {
+    stats.min = round_outwards(min_val, false);
+    stats.max = round_outwards(max_val, true);
+  }
+  return stats;
+}
+} // namespace
+
+std::optional<statistics_t>
+exchange_statistics(write_coordinator &coordinator,
+                    const std::optional<statistics_t> &statistics) {
+  // At most one process contributes non-zero values, so that summing
+  // also transfers the bit patterns of the floating-point values
+  const auto bits = [](float64_t val) {
+    uint64_t res;
+    memcpy(&res, &val, sizeof res);
+    return res;
+  };
+  vector<uint64_t> values(8, 0);
+  if (statistics) {
+    values[0] = 1;
+    values[1] = statistics->count;
+    values[2] = statistics->nan_count;
+    values[3] = statistics->inf_count;
+    if (statistics->min) {
+      values[4] = 1;
+      values[5] = bits(*statistics->min);
+    }
+    if (statistics->max) {
+      values[6] = 1;
+      values[7] = bits(*statistics->max);
+    }
+  }
+  coordinator.allreduce_sum(values);
+  assert(values[0] <= 1);
+  if (!values[0])
+    return {};
+  const auto val = [](uint64_t bits) {
+    float64_t res;
+    memcpy(&res, &bits, sizeof res);
+    return res;
+  };
+  statistics_t result;
+  result.count = values[1];
+  result.nan_count = values[2];
+  result.inf_count = values[3];
+  if (values[4])
+    result.min = val(values[5]);
+  if (values[6])
+    result.max = val(values[7]);
+  return result;
+}
+
+std::optional<statistics_t> ndarray::calculate_statistics() const {
+  if (!datatype->is_scalar)
+    return {};
+  const unsigned char *const ptr =
+      static_cast<const unsigned char *>(get_data()->ptr()) + offset;
+  const bool need_swap = byteorder != host_byteorder();
+  switch (datatype->scalar_type_id) {
+#define ASDF_CALCULATE_STATISTICS(id)                                          \
+  case id:                                                                     \
+    return ASDF::calculate_statistics<get_scalar_type_t<id>>(                  \
+        ptr, shape, strides, need_swap);
+    ASDF_CALCULATE_STATISTICS(id_int8)
+    ASDF_CALCULATE_STATISTICS(id_int16)
+    ASDF_CALCULATE_STATISTICS(id_int32)
+    ASDF_CALCULATE_STATISTICS(id_int64)
+    ASDF_CALCULATE_STATISTICS(id_uint8)
+    ASDF_CALCULATE_STATISTICS(id_uint16)
+    ASDF_CALCULATE_STATISTICS(id_uint32)
+    ASDF_CALCULATE_STATISTICS(id_uint64)
+    ASDF_CALCULATE_STATISTICS(id_float32)
+    ASDF_CALCULATE_STATISTICS(id_float64)
+#undef ASDF_CALCULATE_STATISTICS
+  default:
+    // Booleans, complex numbers, and strings have no range
+    return {};
+  }
+}
+
+// Compound datatypes
+
+namespace {
+// Call `f(offset, index, count)` for each run of elements along the last
+// dimension of an array. `offset` is the byte offset of the run according
+// to the strides, and `index` is the row-major linear index of its first
+// element.
+template <typename F>
+void for_each_run(const vector<int64_t> &shape, const vector<int64_t> &strides,
+                  const F &f) {
+  const int rank = shape.size();
+  for (const auto n : shape)
+    if (n == 0)
+      return;
+  if (rank == 0) {
+    f(int64_t(0), int64_t(0), int64_t(1));
+    return;
+  }
+  vector<int64_t> idx(rank, 0);
+  for (int64_t index = 0;; index += shape[rank - 1]) {
+    int64_t offset = 0;
+    for (int d = 0; d < rank - 1; ++d)
+      offset += idx[d] * strides[d];
+    f(offset, index, shape[rank - 1]);
+    int d = rank - 2;
+    for (; d >= 0; --d) {
+      if (++idx[d] < shape[d])
+        break;
+      idx[d] = 0;
+    }
+    if (d < 0)
+      break;
+  }
+}
+
+// Copy `count` items of `S` bytes between strided locations. With a fixed
+// size, the compiler turns the copies into plain loads and stores.
+template <size_t S>
+void copy_items(unsigned char *dst, int64_t dst_stride,
+                const unsigned char *src, int64_t src_stride, int64_t count) {
+  for (int64_t i = 0; i < count; ++i)
+    memcpy(dst + i * dst_stride, src + i * src_stride, S);
+}
+
+void copy_items(unsigned char *dst, int64_t dst_stride,
+                const unsigned char *src, int64_t src_stride, int64_t count,
+                size_t size) {
+  switch (size) {
+  case 1:
+    return copy_items<1>(dst, dst_stride, src, src_stride, count);
+  case 2:
+    return copy_items<2>(dst, dst_stride, src, src_stride, count);
+  case 4:
+    return copy_items<4>(dst, dst_stride, src, src_stride, count);
+  case 8:
+    return copy_items<8>(dst, dst_stride, src, src_stride, count);
+  case 16:
+    return copy_items<16>(dst, dst_stride, src, src_stride, count);
+  default:
+    for (int64_t i = 0; i < count; ++i)
+      memcpy(dst + i * dst_stride, src + i * src_stride, size);
+  }
+}
+} // namespace
+
+shared_ptr<ndarray> ndarray::get_field(const string &name) const {
+  assert(!datatype->is_scalar);
+  const size_t index = datatype->get_field_index(name);
+  const auto &field = *datatype->fields.at(index);
+  vector<int64_t> field_shape(shape), field_strides(strides);
+  field_shape.insert(field_shape.end(), field.shape.begin(),
+                     field.shape.end());
+  // The elements of a field are stored in row-major order
+  const size_t field_rank = field.shape.size();
+  vector<int64_t> inner_strides(field_rank);
+  int64_t str = field.datatype->type_size();
+  for (int d = field_rank - 1; d >= 0; --d) {
+    inner_strides[d] = str;
+    str *= field.shape[d];
+  }
+  field_strides.insert(field_strides.end(), inner_strides.begin(),
+                       inner_strides.end());
+  return make_shared<ndarray>(
+      mdata, std::optional<block_info_t>(), block_format, compression,
+      compression_level, vector<bool>(), field.datatype,
+      field.have_byteorder ? field.byteorder : byteorder,
+      std::move(field_shape), offset + datatype->get_field_offset(index),
+      std::move(field_strides));
+}
+
+vector<shared_ptr<ndarray>> ndarray::split_fields() const {
+  assert(!datatype->is_scalar);
+  const int rank = shape.size();
+  int64_t npoints = 1;
+  for (const auto n : shape)
+    npoints *= n;
+  // Access the data only once, since other threads might also access them
+  const shared_ptr<block_t> data = get_data().get();
+  const unsigned char *const ptr =
+      static_cast<const unsigned char *>(data->ptr()) + offset;
+  const int64_t stride = rank == 0 ? 0 : strides[rank - 1];
+
+  vector<shared_ptr<ndarray>> arrays;
+  arrays.reserve(datatype->fields.size());
+  size_t field_offset = 0;
+  for (const auto &field : datatype->fields) {
+    const size_t field_size = field->type_size();
+    vector<unsigned char> values(npoints * field_size);
+    for_each_run(shape, strides,
+                 [&](int64_t run_offset, int64_t index, int64_t count) {
+                   copy_items(values.data() + index * field_size, field_size,
+                              ptr + run_offset + field_offset, stride, count,
+                              field_size);
+                 });
+    vector<int64_t> field_shape(shape);
+    field_shape.insert(field_shape.end(), field->shape.begin(),
+                       field->shape.end());
+    arrays.push_back(make_shared<ndarray>(
+        make_constant_memoized(shared_ptr<block_t>(
+            make_shared<typed_block_t<unsigned char>>(std::move(values)))),
+        std::optional<block_info_t>(), block_format, compression,
+        compression_level, vector<bool>(), field->datatype,
+        field->have_byteorder ? field->byteorder : byteorder,
+        std::move(field_shape)));
+    field_offset += field_size;
+  }
+  return arrays;
+}
+
+ndarray ndarray::join_fields(const vector<string> &names,
+                             const vector<shared_ptr<ndarray>> &fields,
+                             block_format_t block_format,
+                             compression_t compression,
+                             int compression_level) {
+  assert(!fields.empty());
+  assert(names.size() == fields.size());
+  const vector<int64_t> &shape = fields[0]->shape;
+  const int rank = shape.size();
+  int64_t npoints = 1;
+  for (const auto n : shape)
+    npoints *= n;
+
+  vector<shared_ptr<field_t>> field_types;
+  for (size_t i = 0; i < fields.size(); ++i) {
+    const auto &arr = *fields[i];
+    assert(arr.shape == shape);
+    // Keep the byte order of each field
+    const bool have_byteorder = arr.byteorder != host_byteorder();
+    field_types.push_back(make_shared<field_t>(
+        names[i], arr.datatype, have_byteorder, arr.byteorder,
+        vector<int64_t>()));
+  }
+  const auto datatype = make_shared<datatype_t>(std::move(field_types));
+  const size_t record_size = datatype->type_size();
+
+  vector<unsigned char> records(npoints * record_size);
+  size_t field_offset = 0;
+  for (const auto &arrp : fields) {
+    const auto &arr = *arrp;
+    const size_t field_size = arr.datatype->type_size();
+    const shared_ptr<block_t> data = arr.get_data().get();
+    const unsigned char *const ptr =
+        static_cast<const unsigned char *>(data->ptr()) + arr.offset;
+    const int64_t stride = rank == 0 ? 0 : arr.strides[rank - 1];
+    for_each_run(shape, arr.strides,
+                 [&](int64_t run_offset, int64_t index, int64_t count) {
+                   copy_items(records.data() + index * record_size +
+                                  field_offset,
+                              record_size, ptr + run_offset, stride, count,
+                              field_size);
+                 });
+    field_offset += field_size;
+  }
+
+  return ndarray(make_constant_memoized(shared_ptr<block_t>(
+                     make_shared<typed_block_t<unsigned char>>(
+                         std::move(records)))),
+                 std::optional<block_info_t>(), block_format, compression,
+                 compression_level, vector<bool>(), datatype,
+                 host_byteorder(), shape);
+}
+
 writer &ndarray::to_yaml(writer &w) const {
+  if (block_format == block_format_t::inline_array) {
+    const int64_t threshold = w.get_options().inline_threshold;
+    int64_t npoints = 1;
+    for (const auto n : shape)
+      npoints *= n;
+    if (threshold >= 0 && npoints > threshold) {
+      // Write a large array as block instead
+      ndarray arr(*this);
+      arr.block_format = block_format_t::block;
+      if (arr.compression == compression_t::undefined)
+        arr.compression = compression_t::none;
+      return arr.to_yaml(w);
+    }
+  }
+
   w << YAML::LocalTag("core/ndarray-1.0.0");
   w << YAML::BeginMap;
   if (block_format == block_format_t::block) {
     // source
     const auto &self = *this;
-    uint64_t idx = w.add_task([=](ostream &os) { self.write_block(os); });
-    w << YAML::Key << "source" << YAML::Value << idx;
+    int64_t npoints = 1;
+    for (const auto n : shape)
+      npoints *= n;
+    if (!mdata.valid()) {
+      // The data are held by another process that writes this file
+      // collectively
+      uint64_t idx = w.add_block(nullptr);
+      w << YAML::Key << "source" << YAML::Value << idx;
+    } else if (w.explode_block(npoints * datatype->type_size())) {
+      const string filename =
+          w.add_external_block([=]() { return self.prepare_block(); });
+      w << YAML::Key << "source" << YAML::Value << YAML::DoubleQuoted
+        << filename;
+    } else {
+      uint64_t idx = w.add_block([=]() { return self.prepare_block(); });
+      w << YAML::Key << "source" << YAML::Value << idx;
+    }
   } else {
     // data
-    w << YAML::Key << "data" << YAML::Value
-      << emit_inline_array(
-             static_cast<const unsigned char *>(get_data()->ptr()) + offset,
-             datatype, byteorder, shape, strides);
+    w << YAML::Key << "data" << YAML::Value;
+    emit_inline_array(
+        w, static_cast<const unsigned char *>(get_data()->ptr()) + offset,
+        datatype, byteorder, shape, strides);
   }
   // mask
   assert(mask.empty());
@@ -835,6 +1454,22 @@ writer &ndarray::to_yaml(writer &w) const {
     w << YAML::Key << "offset" << YAML::Value << offset;
     // strides
     w << YAML::Key << "strides" << YAML::Value << YAML::Flow << strides;
+    // statistics
+    const writer_options &options = w.get_options();
+    std::optional<statistics_t> stats = statistics;
+    if (!stats && options.write_statistics && mdata.valid()) {
+      // Do not keep the data in memory only because of the statistics
+      const bool was_ready = mdata.ready();
+      stats = calculate_statistics();
+      if (!was_ready)
+        mdata.forget();
+    }
+    if (options.write_statistics && options.coordinator)
+      // Only the process that holds the data knows the statistics
+      stats = exchange_statistics(*options.coordinator,
+                                  mdata.valid() ? stats : std::nullopt);
+    if (stats)
+      w << YAML::Key << "statistics" << YAML::Value << yaml_encode(*stats);
   }
   w << YAML::EndMap;
   return w;
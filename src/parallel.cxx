@@ -0,0 +1,54 @@
+#include <asdf/parallel.hxx>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ASDF {
+
+// Parallelism
+
+void parallel_for(int64_t n, int nthreads, const function<void(int64_t)> &f) {
+  if (nthreads <= 0)
+    nthreads = max(1U, thread::hardware_concurrency());
+  nthreads = int(min(int64_t(nthreads), n));
+  if (nthreads <= 1) {
+    for (int64_t i = 0; i < n; ++i)
+      f(i);
+    return;
+  }
+
+  atomic<int64_t> next(0);
+  mutex mtx;
+  exception_ptr error;
+  const auto worker = [&]() {
+    for (;;) {
+      const int64_t i = next++;
+      if (i >= n)
+        break;
+      try {
+        f(i);
+      } catch (...) {
+        lock_guard<mutex> lock(mtx);
+        if (!error)
+          error = current_exception();
+        // Skip the remaining iterations
+        next = n;
+      }
+    }
+  };
+  vector<thread> threads;
+  threads.reserve(nthreads - 1);
+  for (int t = 1; t < nthreads; ++t)
+    threads.emplace_back(worker);
+  worker();
+  for (auto &thr : threads)
+    thr.join();
+  if (error)
+    rethrow_exception(error);
+}
+
+} // namespace ASDF
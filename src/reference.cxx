@@ -3,6 +3,7 @@
 #include <asdf/io.hxx>
 
 #include <cassert>
+#include <charconv>
 #include <exception>
 #include <iomanip>
 #include <memory>
@@ -74,11 +75,11 @@ string fragment_percent_decode(const string &cooked) {
     switch (ch) {
     case '%': {
       assert(pos + 2 <= len);
-      istringstream digs(cooked.substr(pos, 2));
+      unsigned char ch2;
+      const auto res = from_chars(&cooked[pos], &cooked[pos + 2], ch2, 16);
+      assert(res.ec == errc() && res.ptr == &cooked[pos + 2]);
       pos += 2;
-      unsigned int ch2;
-      digs >> hex >> ch2;
-      buf << (unsigned char)ch2;
+      buf << ch2;
       break;
     }
     default:
@@ -129,35 +130,22 @@ string fragment_percent_encode(const string &raw) {
   return cooked;
 }
 
-} // namespace
-
-reference::reference(string target1) : target(std::move(target1)) {}
-
-reference::reference(const string &base_target,
-                     const vector<string> &doc_path) {
-  ostringstream fragment;
-  for (const auto &elem : doc_path)
-    fragment << '/' << tilde_encode(elem);
-  ostringstream buf;
-  buf << base_target << '#' << fragment_percent_encode(fragment.str());
-  target = buf.str();
-}
-
-pair<string, vector<string>> reference::get_split_target() const {
+pair<string, vector<string>> parse_target(const string &target) {
   auto hashpos = target.find('#');
   if (hashpos == string::npos)
     return {target, {}};
   auto base_target = target.substr(0, hashpos);
   auto fragment = fragment_percent_decode(target.substr(hashpos + 1));
   vector<string> doc_path;
+  size_t pos = 0;
   for (;;) {
-    auto slashpos = fragment.find('/');
+    auto slashpos = fragment.find('/', pos);
     if (slashpos == string::npos) {
-      doc_path.push_back(tilde_decode(fragment));
+      doc_path.push_back(tilde_decode(fragment.substr(pos)));
       break;
     }
-    doc_path.push_back(tilde_decode(fragment.substr(0, slashpos)));
-    fragment = fragment.substr(slashpos + 1);
+    doc_path.push_back(tilde_decode(fragment.substr(pos, slashpos - pos)));
+    pos = slashpos + 1;
   }
   // The fragment should either be empty, or should begin with a slash. In both
   // cases, the first element of doc_path should have length zero.
@@ -167,16 +155,32 @@ pair<string, vector<string>> reference::get_split_target() const {
   return {std::move(base_target), std::move(doc_path)};
 }
 
+} // namespace
+
+reference::reference(string target1)
+    : target(std::move(target1)), split_target(parse_target(target)) {}
+
+reference::reference(const string &base_target,
+                     const vector<string> &doc_path) {
+  ostringstream fragment;
+  for (const auto &elem : doc_path)
+    fragment << '/' << tilde_encode(elem);
+  ostringstream buf;
+  buf << base_target << '#' << fragment_percent_encode(fragment.str());
+  target = buf.str();
+  split_target = {base_target, doc_path};
+}
+
 reference::reference(const shared_ptr<reader_state> &rs, const YAML::Node &node)
     : rs(rs) {
   assert(node.IsMap());
   assert(node.size() == 1);
   target = node["$ref"].Scalar();
+  split_target = parse_target(target);
 }
 
-reference::reference(const copy_state &cs, const reference &ref) {
-  target = ref.target;
-}
+reference::reference(const copy_state &cs, const reference &ref)
+    : target(ref.target), split_target(ref.split_target) {}
 
 writer &reference::to_yaml(writer &w) const {
   w << YAML::Flow << YAML::BeginMap;
@@ -0,0 +1,218 @@
+#include <asdf/scan.hxx>
+
+#include <asdf/byteorder.hxx>
+#include <asdf/parallel.hxx>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+namespace ASDF {
+
+// Scanning
+
+predicate predicate::range(float64_t lo, float64_t hi) {
+  return predicate(kind_t::range, lo, hi);
+}
+
+predicate predicate::equal(float64_t value) { return range(value, value); }
+
+predicate predicate::greater(float64_t value) {
+  const float64_t inf = numeric_limits<float64_t>::infinity();
+  // Nothing is greater than infinity; `nextafter` would return infinity
+  if (value == inf)
+    return range(inf, -inf);
+  return range(nextafter(value, inf), inf);
+}
+
+predicate predicate::less(float64_t value) {
+  const float64_t inf = numeric_limits<float64_t>::infinity();
+  // Nothing is less than minus infinity
+  if (value == -inf)
+    return range(inf, -inf);
+  return range(-inf, nextafter(value, -inf));
+}
+
+predicate predicate::finite() { return predicate(kind_t::finite, 0, 0); }
+
+bool predicate::may_match(const statistics_t &statistics) const {
+  switch (kind) {
+  case kind_t::range:
+    // There is no range if all elements are NaN
+    return lo <= hi && statistics.min && statistics.max &&
+           !(*statistics.max < lo) && !(*statistics.min > hi);
+  case kind_t::finite:
+    return statistics.count > statistics.nan_count + statistics.inf_count;
+  }
+  return true;
+}
+
+bool predicate::may_match(const ndarray &arr) const {
+  const auto &statistics = arr.get_statistics();
+  return !statistics || may_match(*statistics);
+}
+
+namespace {
+// Arrays are scanned in segments of at least this many elements in
+// parallel
+constexpr int64_t min_segment_size = 65536;
+
+template <typename T>
+void match_elements(const unsigned char *ptr, int64_t begin, int64_t end,
+                    int64_t stride, bool need_swap, const predicate &pred,
+                    int64_t base, vector<int64_t> &rows) {
+  if (!need_swap && stride == sizeof(T)) {
+    const T *const elts = reinterpret_cast<const T *>(ptr);
+    for (int64_t i = begin; i < end; ++i)
+      if (pred(float64_t(elts[i])))
+        rows.push_back(base + i);
+    return;
+  }
+  for (int64_t i = begin; i < end; ++i) {
+    unsigned char bytes[sizeof(T)];
+    memcpy(bytes, ptr + i * stride, sizeof(T));
+    if (need_swap)
+      reverse(bytes, bytes + sizeof(T));
+    T elt;
+    memcpy(&elt, bytes, sizeof(T));
+    if (pred(float64_t(elt)))
+      rows.push_back(base + i);
+  }
+}
+
+// Find the matching elements of a one-dimensional array, adding `base` to
+// their indices
+vector<int64_t> match_array(const ndarray &arr, const predicate &pred,
+                            int64_t base, int nthreads) {
+  const auto &shape = arr.get_shape();
+  assert(shape.size() == 1);
+  const auto &datatype = *arr.get_datatype();
+  assert(datatype.is_scalar);
+  if (!pred.may_match(arr))
+    return {};
+
+  // Access the data only once, since other threads might also access them
+  const shared_ptr<block_t> data = arr.get_data().get();
+  const unsigned char *const ptr =
+      static_cast<const unsigned char *>(data->ptr()) + arr.get_offset();
+  const int64_t npoints = shape[0];
+  const int64_t stride = arr.get_strides()[0];
+  const bool need_swap = arr.get_byteorder() != host_byteorder();
+
+  const int64_t nsegments =
+      max(int64_t(1), min(int64_t(64), npoints / min_segment_size));
+  vector<vector<int64_t>> segment_rows(nsegments);
+  parallel_for(nsegments, nthreads, [&](int64_t n) {
+    const int64_t begin = n * npoints / nsegments;
+    const int64_t end = (n + 1) * npoints / nsegments;
+    auto &rows = segment_rows[n];
+    switch (datatype.scalar_type_id) {
+#define ASDF_MATCH_ELEMENTS(id)                                                \
+  case id:                                                                     \
+    match_elements<get_scalar_type_t<id>>(ptr, begin, end, stride, need_swap,  \
+                                          pred, base, rows);                   \
+    break;
+      ASDF_MATCH_ELEMENTS(id_int8)
+      ASDF_MATCH_ELEMENTS(id_int16)
+      ASDF_MATCH_ELEMENTS(id_int32)
+      ASDF_MATCH_ELEMENTS(id_int64)
+      ASDF_MATCH_ELEMENTS(id_uint8)
+      ASDF_MATCH_ELEMENTS(id_uint16)
+      ASDF_MATCH_ELEMENTS(id_uint32)
+      ASDF_MATCH_ELEMENTS(id_uint64)
+      ASDF_MATCH_ELEMENTS(id_float32)
+      ASDF_MATCH_ELEMENTS(id_float64)
+#undef ASDF_MATCH_ELEMENTS
+    default:
+      // Only integer and real datatypes can be scanned
+      assert(0);
+    }
+  });
+
+  vector<int64_t> rows;
+  for (auto &segment : segment_rows)
+    rows.insert(rows.end(), segment.begin(), segment.end());
+  return rows;
+}
+
+// Gather the given elements of a one-dimensional array into a new array
+shared_ptr<ndarray> gather_array(const ndarray &arr,
+                                 const vector<int64_t> &rows) {
+  const auto &shape = arr.get_shape();
+  assert(shape.size() == 1);
+  const auto datatype = arr.get_datatype();
+  const int64_t type_size = datatype->type_size();
+  vector<unsigned char> values(rows.size() * type_size);
+  // Do not read the data if there is nothing to gather
+  if (!rows.empty()) {
+    const shared_ptr<block_t> data = arr.get_data().get();
+    const unsigned char *const ptr =
+        static_cast<const unsigned char *>(data->ptr()) + arr.get_offset();
+    const int64_t stride = arr.get_strides()[0];
+    for (size_t n = 0; n < rows.size(); ++n) {
+      assert(rows[n] >= 0 && rows[n] < shape[0]);
+      memcpy(values.data() + n * type_size, ptr + rows[n] * stride,
+             type_size);
+    }
+  }
+  return make_shared<ndarray>(
+      make_constant_memoized(shared_ptr<block_t>(
+          make_shared<typed_block_t<unsigned char>>(std::move(values)))),
+      std::optional<block_info_t>(), block_format_t::block,
+      compression_t::none, 0, vector<bool>(), datatype, arr.get_byteorder(),
+      vector<int64_t>{int64_t(rows.size())});
+}
+} // namespace
+
+vector<int64_t> scan(const ndarray &arr, const predicate &pred,
+                     const scan_options &options) {
+  return match_array(arr, pred, 0, options.nthreads);
+}
+
+vector<int64_t> scan(const tiled_ndarray &arr, const predicate &pred,
+                     const scan_options &options) {
+  assert(arr.get_shape().size() == 1);
+  // Skip the tiles that cannot match, without reading their data
+  vector<const tiled_ndarray::tile_t *> candidates;
+  for (const auto &tile : arr.get_tiles())
+    if (pred.may_match(*tile.array))
+      candidates.push_back(&tile);
+
+  vector<vector<int64_t>> tile_rows(candidates.size());
+  parallel_for(candidates.size(), options.nthreads, [&](int64_t n) {
+    const auto &tile = *candidates[n];
+    tile_rows[n] = match_array(*tile.array, pred, tile.offset.at(0), 1);
+  });
+
+  vector<int64_t> rows;
+  for (auto &tr : tile_rows)
+    rows.insert(rows.end(), tr.begin(), tr.end());
+  // Tiles can be stored in any order
+  sort(rows.begin(), rows.end());
+  return rows;
+}
+
+table_scan_result_t scan(const table &tab, const string &column,
+                         const predicate &pred,
+                         const vector<string> &projection,
+                         const scan_options &options) {
+  const auto col = tab.get_column(column);
+  vector<int64_t> rows = scan(*col->get_data(), pred, options);
+
+  vector<shared_ptr<ASDF::column>> sources;
+  sources.reserve(projection.size());
+  for (const auto &name : projection)
+    sources.push_back(tab.get_column(name));
+  vector<shared_ptr<ASDF::column>> values(sources.size());
+  parallel_for(sources.size(), options.nthreads, [&](int64_t n) {
+    const auto &source = *sources[n];
+    values[n] = make_shared<ASDF::column>(
+        source.get_name(), gather_array(*source.get_data(), rows),
+        source.get_description());
+  });
+
+  return {std::move(rows), table(std::move(values))};
+}
+
+} // namespace ASDF
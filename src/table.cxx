@@ -1,5 +1,10 @@
 #include <asdf/table.hxx>
 
+#include <asdf/parallel.hxx>
+
+#include <cassert>
+#include <stdexcept>
+
 namespace ASDF {
 
 // Table and Column
@@ -12,7 +17,9 @@ column::column(const shared_ptr<reader_state> &rs, const YAML::Node &node) {
     description = node["description"].Scalar();
 }
 
-column::column(const copy_state &cs, const column &col) : column(col) {}
+column::column(const copy_state &cs, const column &col)
+    : name(col.name), data(make_shared<ndarray>(cs, *col.data)),
+      description(col.description) {}
 
 writer &column::to_yaml(writer &w) const {
   w << YAML::LocalTag("core/column-1.0.0");
@@ -48,4 +55,27 @@ writer &table::to_yaml(writer &w) const {
   return w;
 }
 
+shared_ptr<column> table::get_column(const string &name) const {
+  for (const auto &col : columns)
+    if (col->get_name() == name)
+      return col;
+  throw out_of_range("table: no column named \"" + name + "\"");
+}
+
+table table::select(const vector<string> &names) const {
+  vector<shared_ptr<column>> selected;
+  selected.reserve(names.size());
+  for (const auto &name : names)
+    selected.push_back(get_column(name));
+  return table(std::move(selected));
+}
+
+void table::read(int nthreads) const {
+  // Each column is read and decompressed independently; reading the file
+  // itself is serialized by its shared stream
+  parallel_for(columns.size(), nthreads, [&](int64_t n) {
+    columns.at(n)->get_data()->get_data().make_ready();
+  });
+}
+
 } // namespace ASDF
@@ -0,0 +1,263 @@
+#include <asdf/tiled_ndarray.hxx>
+
+#include <asdf/byteorder.hxx>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace ASDF {
+
+// Tiled ndarray
+
+namespace {
+bool same_datatype(const datatype_t &datatype1, const datatype_t &datatype2) {
+  if (datatype1.is_scalar != datatype2.is_scalar)
+    return false;
+  if (datatype1.is_scalar)
+    return datatype1.scalar_type_id == datatype2.scalar_type_id;
+  return YAML::Dump(datatype1.to_yaml()) == YAML::Dump(datatype2.to_yaml());
+}
+
+// Whether elements are already in host byte order. Fields of compound
+// datatypes may specify their own byte order.
+bool is_host_byteorder(const datatype_t &datatype, byteorder_t byteorder) {
+  if (datatype.is_scalar)
+    return byteorder == host_byteorder();
+  for (const auto &field : datatype.fields)
+    if (!is_host_byteorder(*field->datatype, field->have_byteorder
+                                                 ? field->byteorder
+                                                 : byteorder))
+      return false;
+  return true;
+}
+
+// Convert an element to host byte order
+void element_to_host(unsigned char *elem, const datatype_t &datatype,
+                     byteorder_t byteorder) {
+  if (!datatype.is_scalar) {
+    // Convert each element of each field
+    size_t offset = 0;
+    for (const auto &field : datatype.fields) {
+      const byteorder_t field_byteorder =
+          field->have_byteorder ? field->byteorder : byteorder;
+      const size_t size = field->datatype->type_size();
+      const size_t count = field->type_size() / size;
+      for (size_t i = 0; i < count; ++i)
+        element_to_host(elem + offset + i * size, *field->datatype,
+                        field_byteorder);
+      offset += field->type_size();
+    }
+    return;
+  }
+  if (byteorder == host_byteorder())
+    return;
+  size_t size = get_scalar_type_size(datatype.scalar_type_id);
+  size_t nparts = 1;
+  switch (datatype.scalar_type_id) {
+  case id_complex32:
+  case id_complex64:
+  case id_complex128:
+    // Convert the real and imaginary parts separately
+    nparts = 2;
+    size /= 2;
+    break;
+  case id_ascii:
+  case id_ucs4:
+    assert(0);
+  default:
+    break;
+  }
+  for (size_t p = 0; p < nparts; ++p)
+    reverse(elem + p * size, elem + (p + 1) * size);
+}
+
+// Whether two tiles share any elements
+bool tiles_overlap(const vector<int64_t> &offset1,
+                   const vector<int64_t> &shape1,
+                   const vector<int64_t> &offset2,
+                   const vector<int64_t> &shape2) {
+  for (size_t d = 0; d < offset1.size(); ++d)
+    if (offset1[d] >= offset2[d] + shape2[d] ||
+        offset2[d] >= offset1[d] + shape1[d])
+      return false;
+  return true;
+}
+
+// Whether any two tiles share elements. The tiles are swept in the order
+// of their offsets in the first dimension, so that each tile is only
+// compared to the tiles that it overlaps in that dimension.
+bool any_tiles_overlap(const vector<tiled_ndarray::tile_t> &tiles) {
+  vector<const tiled_ndarray::tile_t *> order;
+  for (const auto &tile : tiles) {
+    const auto &tile_shape = tile.array->get_shape();
+    // Empty tiles do not overlap with anything
+    if (find(tile_shape.begin(), tile_shape.end(), 0) == tile_shape.end())
+      order.push_back(&tile);
+  }
+  if (order.empty())
+    return false;
+  if (order[0]->offset.empty())
+    return order.size() > 1;
+  sort(order.begin(), order.end(), [](const auto *x, const auto *y) {
+    return x->offset[0] < y->offset[0];
+  });
+  vector<const tiled_ndarray::tile_t *> active;
+  for (const auto *tile : order) {
+    const int64_t begin = tile->offset[0];
+    const auto ended = [&](const auto *other) {
+      return other->offset[0] + other->array->get_shape()[0] <= begin;
+    };
+    active.erase(remove_if(active.begin(), active.end(), ended), active.end());
+    for (const auto *other : active)
+      if (tiles_overlap(tile->offset, tile->array->get_shape(), other->offset,
+                        other->array->get_shape()))
+        return true;
+    active.push_back(tile);
+  }
+  return false;
+}
+} // namespace
+
+tiled_ndarray::tiled_ndarray(shared_ptr<datatype_t> datatype1,
+                             vector<int64_t> shape1)
+    : datatype(std::move(datatype1)), shape(std::move(shape1)) {
+  assert(datatype);
+  for (const auto n : shape)
+    assert(n >= 0);
+}
+
+void tiled_ndarray::add_tile(vector<int64_t> offset,
+                             shared_ptr<ndarray> array) {
+  assert(array);
+  assert(same_datatype(*array->get_datatype(), *datatype));
+  const auto &tile_shape = array->get_shape();
+  const int rank = shape.size();
+  assert(int(offset.size()) == rank);
+  assert(int(tile_shape.size()) == rank);
+  for (int d = 0; d < rank; ++d)
+    assert(offset[d] >= 0 && offset[d] + tile_shape[d] <= shape[d]);
+  tiles.push_back({std::move(offset), std::move(array)});
+}
+
+tiled_ndarray::tiled_ndarray(const shared_ptr<reader_state> &rs,
+                             const YAML::Node &node) {
+  assert(node.Tag() == tag);
+  datatype = make_shared<datatype_t>(rs, node["datatype"]);
+  yaml_decode(node["shape"], shape);
+  const YAML::Node &tiles_node = node["tiles"];
+  assert(tiles_node.IsSequence());
+  tiles.reserve(tiles_node.size());
+  for (const auto &tile_node : tiles_node) {
+    vector<int64_t> offset;
+    yaml_decode(tile_node["offset"], offset);
+    add_tile(std::move(offset), make_shared<ndarray>(rs, tile_node["array"]));
+  }
+}
+
+tiled_ndarray::tiled_ndarray(const copy_state &cs, const tiled_ndarray &arr)
+    : datatype(arr.datatype), shape(arr.shape) {
+  tiles.reserve(arr.tiles.size());
+  for (const auto &tile : arr.tiles)
+    tiles.push_back({tile.offset, make_shared<ndarray>(cs, *tile.array)});
+}
+
+writer &tiled_ndarray::to_yaml(writer &w) const {
+  // Overlaps are only checked here, since checking every added tile
+  // against all others would be quadratic in the number of tiles
+  assert(!any_tiles_overlap(tiles));
+  w << YAML::VerbatimTag(tag);
+  w << YAML::BeginMap;
+  w << YAML::Key << "datatype" << YAML::Value << datatype->to_yaml(w);
+  w << YAML::Key << "shape" << YAML::Value << YAML::Flow << shape;
+  w << YAML::Key << "tiles" << YAML::Value << YAML::BeginSeq;
+  for (const auto &tile : tiles) {
+    w << YAML::BeginMap;
+    w << YAML::Key << "offset" << YAML::Value << YAML::Flow << tile.offset;
+    w << YAML::Key << "array" << YAML::Value << *tile.array;
+    w << YAML::EndMap;
+  }
+  w << YAML::EndSeq;
+  w << YAML::EndMap;
+  return w;
+}
+
+shared_ptr<block_t>
+tiled_ndarray::read_region(const vector<int64_t> &begin,
+                           const vector<int64_t> &end) const {
+  const int rank = shape.size();
+  assert(int(begin.size()) == rank);
+  assert(int(end.size()) == rank);
+  for (int d = 0; d < rank; ++d)
+    assert(begin[d] >= 0 && begin[d] <= end[d] && end[d] <= shape[d]);
+  const int64_t type_size = datatype->type_size();
+
+  // The region is stored in row-major order
+  vector<int64_t> region_strides(rank);
+  int64_t npoints = 1;
+  for (int d = rank - 1; d >= 0; --d) {
+    region_strides[d] = npoints * type_size;
+    npoints *= end[d] - begin[d];
+  }
+  vector<unsigned char> data(npoints * type_size);
+
+  for (const auto &tile : tiles) {
+    const auto &arr = *tile.array;
+    const auto &tile_shape = arr.get_shape();
+    // Intersect the tile with the region
+    vector<int64_t> lo(rank), hi(rank);
+    bool empty = false;
+    for (int d = 0; d < rank; ++d) {
+      lo[d] = max(begin[d], tile.offset[d]);
+      hi[d] = min(end[d], tile.offset[d] + tile_shape[d]);
+      empty |= lo[d] >= hi[d];
+    }
+    if (empty)
+      continue;
+
+    // Only access the data of tiles that overlap with the region
+    const auto tile_data = arr.get_data();
+    const unsigned char *const tile_ptr =
+        static_cast<const unsigned char *>(tile_data->ptr()) + arr.get_offset();
+    const auto &tile_strides = arr.get_strides();
+    const byteorder_t byteorder = arr.get_byteorder();
+    const bool convert = !is_host_byteorder(*datatype, byteorder);
+
+    // Copy runs along the last dimension, and loop over the others
+    const int64_t run_length = rank == 0 ? 1 : hi[rank - 1] - lo[rank - 1];
+    const bool contiguous = rank == 0 || tile_strides[rank - 1] == type_size;
+    vector<int64_t> idx(lo);
+    for (;;) {
+      const unsigned char *src = tile_ptr;
+      unsigned char *dst = data.data();
+      for (int d = 0; d < rank; ++d) {
+        src += (idx[d] - tile.offset[d]) * tile_strides[d];
+        dst += (idx[d] - begin[d]) * region_strides[d];
+      }
+      if (contiguous) {
+        memcpy(dst, src, run_length * type_size);
+      } else {
+        for (int64_t i = 0; i < run_length; ++i)
+          memcpy(dst + i * type_size, src + i * tile_strides[rank - 1],
+                 type_size);
+      }
+      if (convert)
+        for (int64_t i = 0; i < run_length; ++i)
+          element_to_host(dst + i * type_size, *datatype, byteorder);
+
+      // Next run
+      int d = rank - 2;
+      for (; d >= 0; --d) {
+        if (++idx[d] < hi[d])
+          break;
+        idx[d] = lo[d];
+      }
+      if (d < 0)
+        break;
+    }
+  }
+
+  return make_shared<typed_block_t<unsigned char>>(std::move(data));
+}
+
+} // namespace ASDF
@@ -0,0 +1,105 @@
+#include <asdf/yaml_parser.hxx>
+
+#include <asdf/config.hxx>
+
+#ifdef ASDF_HAVE_RAPIDYAML
+#include <ryml.hpp>
+#endif
+
+#include <cassert>
+#include <istream>
+#include <streambuf>
+
+namespace ASDF {
+
+// YAML parsing
+
+namespace {
+
+#ifndef ASDF_HAVE_RAPIDYAML
+
+// An input stream buffer reading from memory, without copying
+class memory_streambuf : public streambuf {
+public:
+  memory_streambuf(char *begin, char *end) { setg(begin, begin, end); }
+};
+
+#else
+
+string to_string(ryml::csubstr str) { return string(str.str, str.len); }
+
+// Convert a tag to the form yaml-cpp uses. rapidyaml resolves tags to the
+// form "<tag:...>".
+string convert_tag(ryml::csubstr tag) {
+  if (tag.len >= 2 && tag.str[0] == '<' && tag.str[tag.len - 1] == '>')
+    return string(tag.str + 1, tag.len - 2);
+  if (tag.begins_with("!!"))
+    return "tag:yaml.org,2002:" + string(tag.str + 2, tag.len - 2);
+  return to_string(tag);
+}
+
+YAML::Node convert(const ryml::ConstNodeRef &node) {
+  YAML::Node result;
+  if (node.is_map()) {
+    result = YAML::Node(YAML::NodeType::Map);
+    for (const ryml::ConstNodeRef child : node.children())
+      result.force_insert(to_string(child.key()), convert(child));
+  } else if (node.is_seq()) {
+    result = YAML::Node(YAML::NodeType::Sequence);
+    for (const ryml::ConstNodeRef child : node.children())
+      result.push_back(convert(child));
+  } else {
+    assert(node.has_val());
+    const ryml::csubstr val = node.val();
+    const bool quoted = node.is_val_quoted();
+    if (!quoted && !node.has_val_tag() &&
+        (val.empty() || val == "~" || val == "null" || val == "Null" ||
+         val == "NULL")) {
+      result = YAML::Node(YAML::NodeType::Null);
+    } else {
+      result = YAML::Node(to_string(val));
+      // yaml-cpp marks plain scalars with "?" and quoted scalars with "!"
+      result.SetTag(quoted ? "!" : "?");
+    }
+  }
+  if (node.has_val_tag())
+    result.SetTag(convert_tag(node.val_tag()));
+  else if (!node.has_val())
+    // yaml-cpp marks untagged maps and sequences with "?" as well
+    result.SetTag("?");
+  return result;
+}
+
+#endif
+
+} // namespace
+
+#ifndef ASDF_HAVE_RAPIDYAML
+
+string yaml_parser_name() { return "yaml-cpp"; }
+
+YAML::Node yaml_parse(char *begin, char *end) {
+  memory_streambuf buf(begin, end);
+  istream is(&buf);
+  return YAML::Load(is);
+}
+
+#else
+
+string yaml_parser_name() { return "rapidyaml"; }
+
+YAML::Node yaml_parse(char *begin, char *end) {
+  ryml::Tree tree = ryml::parse_in_place(ryml::substr(begin, end - begin));
+  // Replace aliases by copies of their anchored nodes, as yaml-cpp does
+  tree.resolve();
+  // Apply the `%TAG` directives
+  tree.resolve_tags();
+  ryml::ConstNodeRef root = tree.crootref();
+  if (root.is_stream())
+    root = root.first_child();
+  return convert(root);
+}
+
+#endif
+
+} // namespace ASDF
@@ -21,13 +21,19 @@ int main(int argc, char **argv) {
     cerr << msg << "Syntax: " << argv[0]
          << " [--array=(blockinline)] "
             "[--compression=(none|blosc|blosc2|bzip2|libzstd|zlib)] "
-            "[--compression-level=[0-9]] <input file> <output file>\n"
+            "[--compression-level=[0-9]] [--pipeline-depth=<n>] "
+            "[--threads=<n>] [--block-alignment=<n>] [--direct-io] "
+            "[--preload-blocks] [--inline-threshold=<n>] "
+            "[--explode-threshold=<n>] [--statistics] <input file> "
+            "<output file>\n"
          << "Aborting.\n";
     exit(1);
   };
   block_format_t block_format = block_format_t::undefined;
   compression_t compression = compression_t::undefined;
   int compression_level = -1;
+  writer_options options;
+  reader_options roptions;
   vector<string> args;
   for (int argi = 1; argi < argc; ++argi)
     args.push_back(argv[argi]);
@@ -85,6 +91,25 @@ int main(int argc, char **argv) {
       compression_level = 8;
     } else if (opt == "--compression-level=9") {
       compression_level = 9;
+    } else if (opt.rfind("--pipeline-depth=", 0) == 0) {
+      options.pipeline_depth = stoi(opt.substr(opt.find('=') + 1));
+      check(options.pipeline_depth >= 0,
+            "Pipeline depth must not be negative\n");
+    } else if (opt.rfind("--threads=", 0) == 0) {
+      options.nthreads = stoi(opt.substr(opt.find('=') + 1));
+    } else if (opt.rfind("--block-alignment=", 0) == 0) {
+      options.block_alignment = stoull(opt.substr(opt.find('=') + 1));
+    } else if (opt == "--direct-io") {
+      options.direct_io.enable = true;
+      roptions.direct_io.enable = true;
+    } else if (opt == "--preload-blocks") {
+      roptions.preload_blocks = true;
+    } else if (opt.rfind("--inline-threshold=", 0) == 0) {
+      options.inline_threshold = stoll(opt.substr(opt.find('=') + 1));
+    } else if (opt.rfind("--explode-threshold=", 0) == 0) {
+      options.explode_threshold = stoll(opt.substr(opt.find('=') + 1));
+    } else if (opt == "--statistics") {
+      options.write_statistics = true;
     } else {
       assert(0);
     }
@@ -97,7 +122,7 @@ int main(int argc, char **argv) {
   check(!outputfilename.empty(), "Output file name is empty\n");
 
   // Read project
-  auto project = asdf(inputfilename);
+  auto project = asdf(inputfilename, {}, roptions);
 
   // Copy project
   const copy_state cs{block_format != block_format_t::undefined,
@@ -109,7 +134,7 @@ int main(int argc, char **argv) {
   auto project2 = project.copy(cs);
 
   // Write project
-  project2.write(outputfilename);
+  project2.write(outputfilename, options);
 
   cout << "Done.\n";
   return 0;
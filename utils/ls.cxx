@@ -15,81 +15,104 @@ using namespace std;
 
 const int indent_step = 2;
 
-void output(std::ostream &os, const int indent,
-            const std::shared_ptr<entry> &ent);
-void output(std::ostream &os, const int indent,
-            const std::shared_ptr<ndarray> &arr);
-void output(std::ostream &os, const int indent,
-            const std::shared_ptr<reference> &ref);
-void output(std::ostream &os, const int indent,
-            const std::shared_ptr<std::vector<std::shared_ptr<entry>>> &seq);
-void output(
-    std::ostream &os, const int indent,
-    const std::shared_ptr<std::map<std::string, std::shared_ptr<entry>>> &grp);
-void output(std::ostream &os, const int indent,
-            const std::shared_ptr<asdf> &project);
+// Output the block information of all arrays, via a visitor so that the
+// entries are not copied
+class block_info_output : public entry_visitor {
+  std::ostream &os;
+  int indent;
+
+public:
+  block_info_output(std::ostream &os, int indent) : os(os), indent(indent) {}
+
+  void visit(const ndarray_entry &ent) override {
+    const auto &block_info = ent.get_ndarray()->get_block_info();
+    // Inline arrays are not stored in blocks
+    if (!block_info)
+      return;
+    os << std::string(indent, ' ') << "block_info:\n";
+    os << std::string(indent + indent_step, ' ')
+       << "compressor:        " << block_info->compression << "\n";
+    os << std::string(indent + indent_step, ' ')
+       << "uncompressed size: " << block_info->data_space << "\n";
+    os << std::string(indent + indent_step, ' ')
+       << "compressed size:   " << block_info->used_space << "\n";
+    os << std::string(indent + indent_step, ' ') << "compression ratio: "
+       << floor(1000.0 * block_info->used_space / block_info->data_space) / 10
+       << "%\n";
+    os << std::string(indent + indent_step, ' ') << "checksum: ";
+    for (const unsigned char ch : block_info->checksum)
+      os << std::hex << std::setw(2) << std::setfill('0') << int(ch)
+         << std::dec;
+    os << "\n";
+    // The statistics are stored in the tree; the data are not read
+    if (const auto &stats = ent.get_ndarray()->get_statistics()) {
+      os << std::string(indent, ' ') << "statistics:\n";
+      os << std::string(indent + indent_step, ' ')
+         << "count:     " << stats->count << "\n";
+      os << std::string(indent + indent_step, ' ')
+         << "NaN count: " << stats->nan_count << "\n";
+      os << std::string(indent + indent_step, ' ')
+         << "Inf count: " << stats->inf_count << "\n";
+      if (stats->min)
+        os << std::string(indent + indent_step, ' ')
+           << "min:       " << *stats->min << "\n";
+      if (stats->max)
+        os << std::string(indent + indent_step, ' ')
+           << "max:       " << *stats->max << "\n";
+    }
+  }
 
-void output(std::ostream &os, const int indent,
-            const std::shared_ptr<entry> &ent) {
-  // TODO: Handle scalars
-  if (ent->get_maybe_ndarray())
-    output(os, indent, ent->get_maybe_ndarray());
-  if (ent->get_maybe_reference())
-    output(os, indent, ent->get_maybe_reference());
-  if (ent->get_maybe_sequence())
-    output(os, indent, ent->get_maybe_sequence());
-  if (ent->get_maybe_group())
-    output(os, indent, ent->get_maybe_group());
-}
+  void visit(const tiled_ndarray_entry &ent) override {
+    const auto &arr = *ent.get_tiled_ndarray();
+    os << std::string(indent, ' ') << "tiles: " << arr.get_tiles().size()
+       << "\n";
+    block_info_output tiles(os, indent + indent_step);
+    for (const auto &tile : arr.get_tiles()) {
+      os << std::string(indent, ' ') << "- offset: [";
+      for (size_t d = 0; d < tile.offset.size(); ++d)
+        os << (d == 0 ? "" : ", ") << tile.offset[d];
+      os << "]\n";
+      tiles.visit(ndarray_entry(tile.array));
+    }
+  }
 
-void output(std::ostream &os, const int indent,
-            const std::shared_ptr<ndarray> &arr) {
-  const auto block_info = *arr->get_block_info();
-  os << std::string(indent, ' ') << "block_info:\n";
-  os << std::string(indent + indent_step, ' ')
-     << "compressor:        " << block_info.compression << "\n";
-  os << std::string(indent + indent_step, ' ')
-     << "uncompressed size: " << block_info.data_space << "\n";
-  os << std::string(indent + indent_step, ' ')
-     << "compressed size:   " << block_info.used_space << "\n";
-  using std::lrint;
-  os << std::string(indent + indent_step, ' ') << "compression ratio: "
-     << floor(1000.0 * block_info.used_space / block_info.data_space) / 10
-     << "%\n";
-  os << std::string(indent + indent_step, ' ') << "checksum: ";
-  for (const unsigned char ch : block_info.checksum)
-    os << std::hex << std::setw(2) << std::setfill('0') << int(ch) << std::dec;
-  os << "\n";
-}
+  void visit(const table_entry &ent) override {
+    block_info_output columns(os, indent + indent_step);
+    os << std::string(indent, ' ') << "columns:\n";
+    for (const auto &col : ent.get_table()->get_columns()) {
+      os << std::string(indent, ' ') << "- name: " << col->get_name() << "\n";
+      columns.visit(ndarray_entry(col->get_data()));
+    }
+  }
 
-void output(std::ostream &os, const int indent,
-            const std::shared_ptr<reference> &ref) {
-  os << std::string(indent, ' ') << "reference:\n";
-  os << std::string(indent + indent_step, ' ')
-     << "target: " << ref->get_target() << "\n";
-}
+  void visit(const reference_entry &ent) override {
+    os << std::string(indent, ' ') << "reference:\n";
+    os << std::string(indent + indent_step, ' ')
+       << "target: " << ent.get_reference()->get_target() << "\n";
+  }
 
-void output(std::ostream &os, const int indent,
-            const std::shared_ptr<std::vector<std::shared_ptr<entry>>> &seq) {
-  for (const auto &entry : *seq) {
-    os << std::string(indent, ' ') << "-\n";
-    output(os, indent + indent_step, entry);
+  void visit(const sequence &ent) override {
+    block_info_output elements(os, indent + indent_step);
+    for (const auto &value : ent.get_entries()) {
+      os << std::string(indent, ' ') << "-\n";
+      value->visit(elements);
+    }
   }
-}
 
-void output(
-    std::ostream &os, const int indent,
-    const std::shared_ptr<std::map<std::string, std::shared_ptr<entry>>> &grp) {
-  for (const auto &[name, entry] : *grp) {
-    os << std::string(indent, ' ') << name << ":\n";
-    output(os, indent + indent_step, entry);
+  void visit(const group &ent) override {
+    block_info_output entries(os, indent + indent_step);
+    for (const auto &[name, value] : ent.get_entries()) {
+      os << std::string(indent, ' ') << name << ":\n";
+      value->visit(entries);
+    }
   }
-}
+};
 
 void output(std::ostream &os, const int indent,
             const std::shared_ptr<asdf> &project) {
   os << "Project:\n";
-  output(os, indent + indent_step, project->get_group());
+  block_info_output visitor(os, indent + indent_step);
+  project->get_group()->visit(visitor);
 }
 
 int main(int argc, char **argv) {
@@ -122,15 +145,16 @@ int main(int argc, char **argv) {
     string filename = argv[arg];
     assert(!filename.empty());
 
-    // Read project
-    ifstream is(filename, ios::binary | ios::in);
-    auto node = asdf::from_yaml(is);
+    // Read project, parsing the tree only once
+    const auto pis = make_shared<ifstream>(filename, ios::binary | ios::in);
+    const auto node = asdf::from_yaml(*pis);
+    const auto rs = make_shared<reader_state>(node, pis, filename);
 
     // Output project
     cout << node << "\n";
 
     // Output block info
-    const auto project = std::make_shared<asdf>(filename);
+    const auto project = std::make_shared<asdf>(rs, node);
     output(std::cout, 0, project);
   }
 